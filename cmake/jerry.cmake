@@ -1,4 +1,4 @@
-# Copyright (c) 2017, Intel Corporation.
+# Copyright (c) 2017-2018, Intel Corporation.
 
 include(ExternalProject)
 
@@ -51,7 +51,6 @@ set(CMAKE_ARGS
   -DFEATURE_DEBUGGER=${DEBUGGER}
   -DFEATURE_INIT_FINI=ON
   -DFEATURE_PROFILE=${JERRY_PROFILE}
-  -DFEATURE_SNAPSHOT_EXEC=OFF
   -DFEATURE_VALGRIND=OFF
   -DJERRY_CMDLINE=OFF
   -DJERRY_LIBC=OFF
@@ -64,10 +63,12 @@ set(CMAKE_ARGS
 if("${SNAPSHOT}" STREQUAL "on")
   list(APPEND CMAKE_ARGS
     -DFEATURE_JS_PARSER=OFF
+    -DFEATURE_SNAPSHOT_EXEC=ON
   )
 else()
   list(APPEND CMAKE_ARGS
     -DFEATURE_JS_PARSER=ON
+    -DFEATURE_SNAPSHOT_EXEC=OFF
   )
 endif()
 
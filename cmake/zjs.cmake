@@ -1,4 +1,4 @@
-# Copyright (c) 2017, Intel Corporation.
+# Copyright (c) 2017-2018, Intel Corporation.
 
 set_ifndef(JERRY_BASE ./deps/jerryscript)
 set_ifndef(IOTC_BASE ./deps/iotivity-constrained)
@@ -41,6 +41,10 @@ if("${CB_STATS}" STREQUAL "on")
   add_definitions(-DZJS_PRINT_CALLBACK_STATS)
 endif()
 
+if(NOT "${LOOP_STATS}" STREQUAL "off")
+  add_definitions(-DZJS_LOOP_STATS)
+endif()
+
 if("${VARIANT}" STREQUAL "debug")
   add_definitions(-DDEBUG_BUILD -DOC_DEBUG)
 endif()
@@ -67,10 +71,13 @@ set(APP_INCLUDES
 
 set(APP_SRC
   src/main.c
+  src/zjs_bundle.c
   src/zjs_callbacks.c
   src/zjs_common.c
   src/zjs_error.c
+  src/zjs_loop_stats.c
   src/zjs_modules.c
+  src/zjs_queue.c
   src/zjs_script.c
   src/zjs_timers.c
   src/zjs_util.c
@@ -1,4 +1,4 @@
-# Copyright (c) 2017, Intel Corporation.
+# Copyright (c) 2017-2018, Intel Corporation.
 
 project(NONE C)
 include(ExternalProject)
@@ -25,6 +25,7 @@ set(APP_SRC
   ${CMAKE_SOURCE_DIR}/src/main.c
   ${CMAKE_SOURCE_DIR}/src/zjs_board.c
   ${CMAKE_SOURCE_DIR}/src/zjs_buffer.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_bundle.c
   ${CMAKE_SOURCE_DIR}/src/zjs_callbacks.c
   ${CMAKE_SOURCE_DIR}/src/zjs_common.c
   ${CMAKE_SOURCE_DIR}/src/zjs_console.c
@@ -32,10 +33,12 @@ set(APP_SRC
   ${CMAKE_SOURCE_DIR}/src/zjs_event.c
   ${CMAKE_SOURCE_DIR}/src/zjs_gpio.c
   ${CMAKE_SOURCE_DIR}/src/zjs_gpio_mock.c
-  ${CMAKE_SOURCE_DIR}/src/zjs_linux_ring_buffer.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_linux_loop.c
   ${CMAKE_SOURCE_DIR}/src/zjs_linux_time.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_loop_stats.c
   ${CMAKE_SOURCE_DIR}/src/zjs_modules.c
   ${CMAKE_SOURCE_DIR}/src/zjs_performance.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_queue.c
   ${CMAKE_SOURCE_DIR}/src/zjs_script.c
   ${CMAKE_SOURCE_DIR}/src/zjs_timers.c
   ${CMAKE_SOURCE_DIR}/src/zjs_test_promise.c
@@ -81,6 +84,10 @@ if("${CB_STATS}" STREQUAL "on")
   add_definitions(-DZJS_PRINT_CALLBACK_STATS)
 endif()
 
+if(NOT "${LOOP_STATS}" STREQUAL "off")
+  add_definitions(-DZJS_LOOP_STATS)
+endif()
+
 if("${VARIANT}" STREQUAL "debug")
   add_definitions(-DDEBUG_BUILD -DOC_DEBUG)
   list(APPEND APP_COMPILE_OPTIONS -g)
@@ -171,6 +178,9 @@ add_custom_command(
     --jerry-cmdline=OFF
     --jerry-libc=OFF
     --jerry-debugger=${DEBUGGER}
+    --snapshot-save=ON
+    --snapshot-exec=ON
+    --mem-stats=ON
   )
 
 add_executable(jslinux ${APP_SRC})
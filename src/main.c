@@ -34,16 +34,18 @@
 #include "jerryscript-port.h"
 
 // Platform agnostic modules/headers
+#ifdef BUILD_MODULE_BUFFER
+#include "zjs_buffer.h"
+#endif
+#include "zjs_bundle.h"
 #include "zjs_callbacks.h"
 #include "zjs_error.h"
+#include "zjs_loop_stats.h"
 #include "zjs_modules.h"
 #ifdef BUILD_MODULE_SENSOR
 #include "zjs_sensor.h"
 #endif
 #include "zjs_timers.h"
-#ifdef BUILD_MODULE_OCF
-#include "zjs_ocf_common.h"
-#endif
 #ifdef BUILD_MODULE_BLE
 #include "zjs_ble.h"
 #endif
@@ -57,7 +59,9 @@
 #define ZJS_MAX_PRINT_SIZE 512
 
 #ifdef ZJS_SNAPSHOT_BUILD
-const uint32_t snapshot_bytecode[] = {
+// a bundle of the application and its JS modules, executed in place; static
+//   literals are addressed directly, so this needs 8-byte alignment
+const uint32_t snapshot_bytecode[] __attribute__((aligned(8))) = {
 #include "zjs_snapshot_gen.h"
 };
 const size_t snapshot_len = sizeof(snapshot_bytecode);
@@ -87,6 +91,37 @@ static u8_t no_exit = 0;
 // if > 0, jslinux will exit after this many milliseconds
 static u32_t exit_after = 0;
 static struct timespec exit_timer;
+#ifdef ZJS_LOOP_STATS
+// enabled if --latency is passed to jslinux
+static u8_t print_latency = 0;
+#endif
+#ifdef BUILD_MODULE_BUFFER
+// enabled if --pool-stats is passed to jslinux
+static u8_t print_pool_stats = 0;
+#endif
+// set if --snapshot-cache <dir> is passed to jslinux
+static char *snapshot_cache = NULL;
+// enabled if --startup-time is passed to jslinux
+static u8_t print_startup_time = 0;
+// enabled if --startup-profile is passed to jslinux
+static u8_t print_startup_profile = 0;
+
+static void print_exit_stats(void)
+{
+#ifdef ZJS_LOOP_STATS
+    if (print_latency) {
+        zjs_print_callback_latency();
+    }
+#endif
+#ifdef BUILD_MODULE_BUFFER
+    if (print_pool_stats) {
+        zjs_print_buffer_pool_stats();
+    }
+#endif
+    if (print_startup_profile) {
+        zjs_print_startup_profile();
+    }
+}
 
 u8_t process_cmd_line(int argc, char *argv[])
 {
@@ -95,6 +130,9 @@ u8_t process_cmd_line(int argc, char *argv[])
         if (!strncmp(argv[i], "--unittest", 10)) {
             // run unit tests
             zjs_run_unit_tests();
+        } else if (!strncmp(argv[i], "--bench", 7)) {
+            // run microbenchmarks
+            zjs_run_benchmarks();
         } else if (!strncmp(argv[i], "--debugger", 10)) {
 #ifdef ZJS_DEBUGGER
             // run in debugger
@@ -105,6 +143,30 @@ u8_t process_cmd_line(int argc, char *argv[])
 #endif
         } else if (!strncmp(argv[i], "--noexit", 8)) {
             no_exit = 1;
+        } else if (!strncmp(argv[i], "--latency", 9)) {
+#ifdef ZJS_LOOP_STATS
+            // print callback latency on exit
+            print_latency = 1;
+#else
+            ERR_PRINT("Latency stats disabled, rebuild with LOOP_STATS=on\n");
+            return 0;
+#endif
+        } else if (!strncmp(argv[i], "--pool-stats", 12)) {
+#ifdef BUILD_MODULE_BUFFER
+            // print Buffer pool usage on exit
+            print_pool_stats = 1;
+#endif
+        } else if (!strncmp(argv[i], "--snapshot-cache", 16)) {
+            if (i == argc - 1) {
+                ERR_PRINT("no directory given after '--snapshot-cache'\n");
+                return 0;
+            }
+            snapshot_cache = argv[++i];
+        } else if (!strncmp(argv[i], "--startup-time", 14)) {
+            print_startup_time = 1;
+        } else if (!strncmp(argv[i], "--startup-profile", 17)) {
+            // print global module init costs on exit
+            print_startup_profile = 1;
         } else if (!strncmp(argv[i], "-t", 2)) {
             if (i == argc - 1) {
                 // no time argument, return error
@@ -184,8 +246,11 @@ int main(int argc, char *argv[])
     size_t file_name_len = 0;
 #ifdef ZJS_LINUX_BUILD
     char *script = NULL;
+    const uint32_t *snapshot = NULL;
+    struct timespec startup = { 0 };
     if (argc < 2) {
-        ZJS_PRINT("usage: jslinux [--unittests] [path/to/file.js]\n");
+        ZJS_PRINT("usage: jslinux [--unittests] "
+                  "[path/to/file.js | path/to/file.snapshot]\n");
         return 1;
     }
 
@@ -203,8 +268,8 @@ int main(int argc, char *argv[])
 #endif
 #ifndef ZJS_LINUX_BUILD
     DBG_PRINT("Main Thread ID: %p\n", (void *)k_current_get());
-    zjs_loop_init();
 #endif
+    zjs_loop_init();
     jerry_value_t result;
 
     // print newline here to make it easier to find
@@ -215,10 +280,6 @@ int main(int argc, char *argv[])
     // initialize modules
     zjs_modules_init();
 
-#ifdef BUILD_MODULE_OCF
-    zjs_register_service_routine(NULL, main_poll_routine);
-#endif
-
 #ifdef ZJS_ASHELL
     if (config_mode_detected()) {
         // go into IDE mode if connected GPIO button is pressed
@@ -260,7 +321,14 @@ int main(int argc, char *argv[])
             ERR_PRINT("command line options error\n");
             goto error;
         }
-        if (zjs_read_script(argv[1], &script, &script_len)) {
+        clock_gettime(CLOCK_MONOTONIC, &startup);
+        if (zjs_script_is_snapshot(argv[1])) {
+            // run in place from the page cache rather than from a copy
+            if (zjs_map_snapshot(argv[1], &snapshot, &script_len)) {
+                ERR_PRINT("could not map snapshot file %s\n", argv[1]);
+                goto error;
+            }
+        } else if (zjs_read_script(argv[1], &script, &script_len)) {
             ERR_PRINT("could not read script file %s\n", argv[1]);
             goto error;
         }
@@ -293,31 +361,73 @@ int main(int argc, char *argv[])
 #endif
 
 #ifndef ZJS_SNAPSHOT_BUILD
-    code_eval = jerry_parse((jerry_char_t *)file_name,
-                            file_name_len,
-                            (jerry_char_t *)script,
-                            script_len,
-                            JERRY_PARSE_NO_OPTS);
-
-    if (jerry_value_is_error(code_eval)) {
-        DBG_PRINT("Error parsing JS\n");
-        zjs_print_error_message(code_eval, ZJS_UNDEFINED);
-        goto error;
+    code_eval = ZJS_UNDEFINED;
+#ifdef ZJS_LINUX_BUILD
+    // precompiled and cached snapshots skip the parser entirely
+    const char *startup_mode = "source";
+    zjs_cache_status_t cached = ZJS_CACHE_UNUSED;
+#ifdef ZJS_DEBUGGER
+    if (start_debug_server) {
+        // the debugger needs the source
+        snapshot_cache = NULL;
     }
 #endif
-
+    if (snapshot && zjs_bundle_check(snapshot, script_len)) {
+        // an application bundled with its JS modules by tools/snapshot
+        result = zjs_bundle_run_main(snapshot);
+        startup_mode = "snapshot bundle";
+    } else if (snapshot) {
+        result = zjs_exec_snapshot(snapshot, script_len);
+        startup_mode = "snapshot";
+    } else if (snapshot_cache) {
+        cached = zjs_run_cached_script(snapshot_cache, script, script_len,
+                                       &result);
+        if (cached != ZJS_CACHE_UNUSED) {
+            startup_mode = (cached == ZJS_CACHE_HIT) ? "cached snapshot"
+                                                     : "snapshot cache miss";
+        }
+    }
+    if (!snapshot && cached == ZJS_CACHE_UNUSED)
+#endif
+    {
+        code_eval = jerry_parse((jerry_char_t *)file_name,
+                                file_name_len,
+                                (jerry_char_t *)script,
+                                script_len,
+                                JERRY_PARSE_NO_OPTS);
+
+        if (jerry_value_is_error(code_eval)) {
+            DBG_PRINT("Error parsing JS\n");
+            zjs_print_error_message(code_eval, ZJS_UNDEFINED);
+            goto error;
+        }
 #ifdef ZJS_LINUX_BUILD
-    zjs_free(script);
+        zjs_free(script);
+        script = NULL;
+#endif
+        result = jerry_run(code_eval);
+    }
+#ifdef ZJS_LINUX_BUILD
+    if (script) {
+        zjs_free(script);
+    }
+    if (print_startup_time) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        u32_t elapsed = (1000000 * (now.tv_sec - startup.tv_sec)) +
+            ((now.tv_nsec - startup.tv_nsec) / 1000);
+        ZJS_PRINT("jslinux: startup took %u us from %s\n",
+                  (unsigned int)elapsed, startup_mode);
+    }
 #endif
-
-#ifdef ZJS_SNAPSHOT_BUILD
-    result = jerry_exec_snapshot(snapshot_bytecode,
-                                 snapshot_len,
-                                 0,
-                                 JERRY_SNAPSHOT_EXEC_COPY_DATA);
-
 #else
-    result = jerry_run(code_eval);
+    // run the bytecode straight from flash; with static literals the
+    //   snapshot costs no JS heap at all
+    if (!zjs_bundle_check(snapshot_bytecode, snapshot_len)) {
+        ERR_PRINT("invalid snapshot bundle\n");
+        goto error;
+    }
+    result = zjs_bundle_run_main(snapshot_bytecode);
 #endif
 
     if (jerry_value_is_error(result)) {
@@ -358,6 +468,9 @@ int main(int argc, char *argv[])
 
     jerry_release_value(result);
 
+    // ticks queued by the main script run before anything else
+    zjs_timers_run_ticks();
+
 #ifdef ZJS_LINUX_BUILD
     u8_t last_serviced = 1;
 #endif
@@ -368,6 +481,7 @@ int main(int argc, char *argv[])
     }
 #endif
     while (1) {
+        ZJS_LOOP_STATS_WAKE();
 #ifdef ZJS_DYNAMIC_LOAD
         // Check if we should load a new JS file
         zjs_modules_check_load_file();
@@ -379,6 +493,7 @@ int main(int argc, char *argv[])
 #endif
         s32_t wait_time = ZJS_TICKS_FOREVER;
         u8_t serviced = 0;
+        u8_t cb_serviced = 0;
 
         // callback cannot return a wait time
         if (zjs_service_callbacks()) {
@@ -386,26 +501,46 @@ int main(int argc, char *argv[])
             //   timer, it would think there were no timers and block forever
             // FIXME: need to consider the chicken and egg problems here
             serviced = 1;
+            cb_serviced = 1;
         }
-#ifdef ZJS_LINUX_BUILD
-        // FIXME - reverted patch #1542 to old timer implementation
+        // process.nextTick callbacks run before the loop moves on
+        zjs_timers_run_ticks();
+        ZJS_LOOP_STATS_MARK(ZJS_LOOP_CALLBACKS);
+        // timers are polled here rather than firing on their own, so the ones
+        //   due close together share a wakeup
         u64_t wait = zjs_timers_process_events();
         if (wait != ZJS_TICKS_FOREVER) {
             serviced = 1;
             wait_time = (wait < wait_time) ? wait : wait_time;
         }
+        zjs_timers_run_ticks();
+        ZJS_LOOP_STATS_MARK(ZJS_LOOP_TIMERS);
         wait = zjs_service_routines();
-#else
-        u64_t wait = zjs_service_routines();
-#endif
         if (wait != ZJS_TICKS_FOREVER) {
             serviced = 1;
             wait_time = (wait < wait_time) ? wait : wait_time;
         }
+        ZJS_LOOP_STATS_MARK(ZJS_LOOP_ROUTINES);
         // callback cannot return a wait time
         if (zjs_service_callbacks()) {
             serviced = 1;
+            cb_serviced = 1;
+        }
+        zjs_timers_run_ticks();
+        ZJS_LOOP_STATS_MARK(ZJS_LOOP_CALLBACKS);
+        if (cb_serviced && zjs_callbacks_pending()) {
+            // the time budget ran out before the queue was drained, so check
+            //   again before going to sleep
+            wait_time = ZJS_TICKS_NONE;
+        }
+
+        // run setImmediate calls; ones they queue wait for the next pass, so
+        //   don't sleep in between
+        if (zjs_timers_run_immediates()) {
+            serviced = 1;
+            wait_time = ZJS_TICKS_NONE;
         }
+        ZJS_LOOP_STATS_MARK(ZJS_LOOP_IMMEDIATES);
 
 #ifdef BUILD_MODULE_PROMISE
         // run queued jobs for promises
@@ -415,11 +550,10 @@ int main(int argc, char *argv[])
             zjs_print_error_message(result, ZJS_UNDEFINED);
             goto error;
         }
+        zjs_timers_run_ticks();
+        ZJS_LOOP_STATS_MARK(ZJS_LOOP_JOBS);
 #endif
 
-#ifndef ZJS_LINUX_BUILD
-        zjs_loop_block(wait_time);
-#endif
 #ifdef ZJS_LINUX_BUILD
         if (!no_exit) {
             // if the last and current loop had no pending "events" (timers or
@@ -428,6 +562,7 @@ int main(int argc, char *argv[])
                 ZJS_PRINT("\njslinux: no more timers or callbacks found, exiting!\n");
                 ZJS_PRINT("   * to run your script indefinitely, use --noexit\n");
                 ZJS_PRINT("   * to run your script for a set timeout, use -t <ms>\n");
+                print_exit_stats();
                 return 0;
             }
         }
@@ -440,11 +575,23 @@ int main(int argc, char *argv[])
             if (elapsed >= exit_after) {
                 ZJS_PRINT("%u milliseconds have passed, exiting!\n",
                           (unsigned int)elapsed);
+                print_exit_stats();
                 return 0;
             }
+            // wake up in time to exit
+            u32_t remaining = exit_after - elapsed;
+            if ((u32_t)wait_time > remaining) {
+                wait_time = remaining;
+            }
         }
         last_serviced = serviced;
+        if (!no_exit && !serviced) {
+            // don't sleep, so the auto exit check above runs again right away
+            wait_time = ZJS_TICKS_NONE;
+        }
 #endif
+        ZJS_LOOP_STATS_SLEEP();
+        zjs_loop_block(wait_time);
     }
 error:
 #ifdef ZJS_LINUX_BUILD
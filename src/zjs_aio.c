@@ -32,12 +32,14 @@ static jerry_value_t zjs_aio_prototype = 0;
 typedef struct aio_handle {
     struct device *dev;
     jerry_value_t pin_obj;
+    zjs_event_token change_token;
     u16_t pin;
     u16_t last_value;
     struct aio_handle *next;
 } aio_handle_t;
 
 static aio_handle_t *opened_handles = NULL;
+static zjs_routine_t *aio_routine = NULL;
 
 // get the aio handle or return a JS error
 #define GET_AIO_HANDLE(obj, var)                                     \
@@ -174,41 +176,41 @@ static ZJS_DECL_FUNC(zjs_aio_open)
 
     // make it an emitter object
     zjs_make_emitter(pin_obj, zjs_aio_prototype, handle, aio_free_cb);
+    handle->change_token = zjs_register_deferred_event(pin_obj, "change",
+                                                       zjs_copy_arg,
+                                                       zjs_release_args);
 
     // add to the list of opened handles
     ZJS_LIST_APPEND(aio_handle_t, opened_handles, handle);
+    // start sampling if this is the first one
+    zjs_wake_service_routine(aio_routine);
     return jerry_acquire_value(pin_obj);
 }
 
 static s32_t aio_poll_routine(void *h)
 {
     FTRACE("h = %p\n", h);
-    static u32_t last_read_time = 0;
-    u32_t uptime = k_uptime_get_32();
-    if ((uptime - last_read_time) > ((u32_t)(CONFIG_SYS_CLOCK_TICKS_PER_SEC /
-                                             AIO_POLL_FREQUENCY * 10))) {
-        aio_handle_t *handle = opened_handles;
-        while (handle) {
-            // FIXME: We dont know when a object subscribes to onchange
-            // events, need a way to intercept the .on()
-            // currently, if the pin is opened, then it do a read
-            // and signal the event, this could slow down the system
-            // when there are multiple AIO pins opened.
-            u16_t value = pin_read(handle->dev, handle->pin);
-            if (value != handle->last_value) {
-                handle->last_value = value;
-                ZVAL val = jerry_create_number(value);
-                zjs_defer_emit_event(handle->pin_obj, "change", &val,
-                                     sizeof(val), zjs_copy_arg,
-                                     zjs_release_args);
-            }
-            handle = handle->next;
-        }
-        last_read_time = uptime;
+    if (!opened_handles) {
+        // nothing to sample until a pin is opened
+        return K_FOREVER;
     }
 
-    zjs_loop_unblock();
-    return K_FOREVER;
+    aio_handle_t *handle = opened_handles;
+    while (handle) {
+        // FIXME: We dont know when a object subscribes to onchange
+        // events, need a way to intercept the .on()
+        // currently, if the pin is opened, then it do a read
+        // and signal the event, this could slow down the system
+        // when there are multiple AIO pins opened.
+        u16_t value = pin_read(handle->dev, handle->pin);
+        if (value != handle->last_value) {
+            handle->last_value = value;
+            ZVAL val = jerry_create_number(value);
+            zjs_defer_emit_token(handle->change_token, &val, sizeof(val));
+        }
+        handle = handle->next;
+    }
+    return 1000 / AIO_POLL_FREQUENCY;
 }
 
 static void zjs_aio_cleanup(void *native)
@@ -219,6 +221,7 @@ static void zjs_aio_cleanup(void *native)
         opened_handles = opened_handles->next;
     }
     jerry_release_value(zjs_aio_prototype);
+    aio_routine = NULL;
     zjs_unregister_service_routine(aio_poll_routine);
 }
 
@@ -229,8 +232,7 @@ static const jerry_object_native_info_t aio_module_type_info = {
 jerry_value_t zjs_aio_init()
 {
     FTRACE("");
-    // FIXME: need a way to unregister service routines
-    zjs_register_service_routine(NULL, aio_poll_routine);
+    aio_routine = zjs_register_service_routine(NULL, aio_poll_routine);
 
     zjs_native_func_t array[] = {
         { zjs_aio_pin_read, "read" },
@@ -24,6 +24,7 @@ static jerry_value_t zjs_aio_prototype;
 
 typedef struct aio_handle {
     jerry_value_t pin_obj;
+    zjs_event_token change_token;
     u32_t pin;
 } aio_handle_t;
 
@@ -139,8 +140,7 @@ static void ipm_msg_receive_callback(void *context, u32_t id,
             DBG_PRINT("aio async read %d\n", pin_value);
             break;
         case TYPE_AIO_PIN_EVENT_VALUE_CHANGE:
-            zjs_defer_emit_event(handle->pin_obj, "change", &num,
-                                 sizeof(num), zjs_copy_arg, zjs_release_args);
+            zjs_defer_emit_token(handle->change_token, &num, sizeof(num));
             break;
         case TYPE_AIO_PIN_SUBSCRIBE:
             DBG_PRINT("subscribed to events on pin %u\n", pin);
@@ -258,6 +258,9 @@ static ZJS_DECL_FUNC(zjs_aio_open)
 
     // make it an emitter object
     zjs_make_emitter(pinobj, zjs_aio_prototype, handle, aio_free_cb);
+    handle->change_token = zjs_register_deferred_event(pinobj, "change",
+                                                       zjs_copy_arg,
+                                                       zjs_release_args);
     zjs_aio_ipm_send_async(TYPE_AIO_PIN_SUBSCRIBE, pin, handle);
 
     return pinobj;
@@ -13,16 +13,234 @@
 #include "zjs_common.h"
 #include "zjs_util.h"
 
-static jerry_value_t zjs_buffer_prototype;
+static jerry_value_t zjs_buffer_prototype = 0;
+
+static void init_prototype();
+
+// the pool arena, carved into blocks on demand and never given back
+static u64_t pool_arena[ZJS_BUFFER_POOL_SIZE / sizeof(u64_t)];
+static u32_t pool_carved = 0;
+static void *pool_free_list[ZJS_BUFFER_POOL_CLASSES];
+static zjs_buffer_pool_stats_t pool_stats[ZJS_BUFFER_POOL_CLASSES];
+
+static int pool_class(u32_t size)
+{
+    // effects: returns the smallest size class that fits size bytes, or -1
+    u32_t block = ZJS_BUFFER_POOL_MIN_BLOCK;
+    for (int i = 0; i < ZJS_BUFFER_POOL_CLASSES; i++) {
+        if (size <= block) {
+            return i;
+        }
+        block <<= 1;
+    }
+    return -1;
+}
+
+static void *pool_alloc(u32_t size)
+{
+    // effects: allocates a block of at least size bytes from the pool, or
+    //            from the heap if there is no class for it or the arena is
+    //            used up
+    int index = pool_class(size);
+    if (index < 0) {
+        return zjs_malloc(size);
+    }
+
+    zjs_buffer_pool_stats_t *stats = &pool_stats[index];
+    u32_t block_size = ZJS_BUFFER_POOL_MIN_BLOCK << index;
+    void *block = pool_free_list[index];
+    if (block) {
+        pool_free_list[index] = *(void **)block;
+    } else if (pool_carved + block_size <= sizeof(pool_arena)) {
+        block = (u8_t *)pool_arena + pool_carved;
+        pool_carved += block_size;
+        stats->blocks++;
+    } else {
+        stats->misses++;
+        return zjs_malloc(size);
+    }
+
+    stats->allocs++;
+    if (++stats->in_use > stats->peak) {
+        stats->peak = stats->in_use;
+    }
+    return block;
+}
+
+static void pool_free(void *block, u32_t size)
+{
+    // requires: block was returned by pool_alloc for the same size
+    u8_t *arena = (u8_t *)pool_arena;
+    if ((u8_t *)block < arena || (u8_t *)block >= arena + sizeof(pool_arena)) {
+        zjs_free(block);
+        return;
+    }
+
+    int index = pool_class(size);
+    *(void **)block = pool_free_list[index];
+    pool_free_list[index] = block;
+    pool_stats[index].in_use--;
+}
+
+bool zjs_get_buffer_pool_stats(u32_t index, zjs_buffer_pool_stats_t *stats)
+{
+    if (index >= ZJS_BUFFER_POOL_CLASSES) {
+        return false;
+    }
+    *stats = pool_stats[index];
+    stats->block_size = ZJS_BUFFER_POOL_MIN_BLOCK << index;
+    return true;
+}
+
+void zjs_print_buffer_pool_stats(void)
+{
+    ZJS_PRINT("\n----------- Buffer Pool (%u/%u bytes) -----------\n",
+              (unsigned int)pool_carved, (unsigned int)sizeof(pool_arena));
+    ZJS_PRINT("%6s %8s %8s %8s %10s %8s\n", "block", "carved", "in use",
+              "peak", "allocs", "misses");
+    for (u32_t i = 0; i < ZJS_BUFFER_POOL_CLASSES; i++) {
+        zjs_buffer_pool_stats_t stats;
+        zjs_get_buffer_pool_stats(i, &stats);
+        ZJS_PRINT("%6u %8u %8u %8u %10u %8u\n",
+                  (unsigned int)stats.block_size, (unsigned int)stats.blocks,
+                  (unsigned int)stats.in_use, (unsigned int)stats.peak,
+                  (unsigned int)stats.allocs, (unsigned int)stats.misses);
+    }
+    ZJS_PRINT("---------------------- End ----------------------\n");
+}
+
+// size of the single block holding a Buffer's view, store and data
+#define INLINE_BLOCK_SIZE(size) \
+    (sizeof(zjs_buffer_t) + sizeof(zjs_buffer_store_t) + (size))
+
+zjs_buffer_store_t *zjs_buffer_store_alloc(u32_t size)
+{
+    zjs_buffer_store_t *store =
+        (zjs_buffer_store_t *)pool_alloc(sizeof(zjs_buffer_store_t) + size);
+    if (store) {
+        store->refcount = 1;
+        store->size = size;
+        store->inline_view = 0;
+        store->data = (u8_t *)(store + 1);
+        store->owner = ZJS_UNDEFINED;
+    }
+    return store;
+}
+
+zjs_buffer_store_t *zjs_buffer_store_wrap(jerry_value_t arraybuffer)
+{
+    // requires: arraybuffer is an ArrayBuffer
+    zjs_buffer_store_t *store =
+        (zjs_buffer_store_t *)pool_alloc(sizeof(zjs_buffer_store_t));
+    if (store) {
+        store->refcount = 1;
+        store->size = jerry_get_arraybuffer_byte_length(arraybuffer);
+        store->inline_view = 0;
+        store->data = jerry_get_arraybuffer_pointer(arraybuffer);
+        store->owner = jerry_acquire_value(arraybuffer);
+    }
+    return store;
+}
+
+static void arraybuffer_free(void *native_p)
+{
+    // effects: drops the reference an ArrayBuffer from
+    //            zjs_buffer_store_to_arraybuffer held on its store
+    zjs_buffer_store_release((zjs_buffer_store_t *)native_p - 1);
+}
+
+jerry_value_t zjs_buffer_store_to_arraybuffer(zjs_buffer_store_t *store)
+{
+    if (!jerry_value_is_undefined(store->owner)) {
+        // the memory already belongs to an ArrayBuffer
+        return jerry_acquire_value(store->owner);
+    }
+    if (!jerry_is_feature_enabled(JERRY_FEATURE_TYPEDARRAY)) {
+        return zjs_error_context("ArrayBuffer not supported", 0, 0);
+    }
+
+    // the data follows the store, so the free callback can find it again
+    jerry_value_t arraybuffer =
+        jerry_create_arraybuffer_external(store->size, store->data,
+                                          arraybuffer_free);
+    if (!jerry_value_is_error(arraybuffer)) {
+        zjs_buffer_store_acquire(store);
+    }
+    return arraybuffer;
+}
+
+zjs_buffer_store_t *zjs_buffer_store_acquire(zjs_buffer_store_t *store)
+{
+    store->refcount++;
+    return store;
+}
+
+void zjs_buffer_store_release(zjs_buffer_store_t *store)
+{
+    if (store && --store->refcount == 0) {
+        if (!jerry_value_is_undefined(store->owner)) {
+            jerry_release_value(store->owner);
+            pool_free(store, sizeof(zjs_buffer_store_t));
+        } else if (store->inline_view) {
+            pool_free((u8_t *)store - sizeof(zjs_buffer_t),
+                      INLINE_BLOCK_SIZE(store->size));
+        } else {
+            pool_free(store, sizeof(zjs_buffer_store_t) + store->size);
+        }
+    }
+}
+
+bool zjs_buffer_store_reserve(zjs_buffer_store_t **store, u8_t **rptr,
+                              u8_t **wptr, u32_t bytes)
+{
+    // requires: *rptr <= *wptr, both within (*store)->data
+    //  effects: ensures bytes can be written at *wptr, moving unread data to
+    //             the start of the store or into a new store if needed
+    zjs_buffer_store_t *old = *store;
+    u32_t unread = *wptr - *rptr;
+    if (*wptr + bytes <= old->data + old->size) {
+        return true;
+    }
+
+    if (old->refcount == 1 && unread + bytes <= old->size) {
+        // nobody else can see these bytes, so just reuse the space
+        memmove(old->data, *rptr, unread);
+        *rptr = old->data;
+        *wptr = old->data + unread;
+        return true;
+    }
+
+    // JS still holds views of this store, or it was too small; start a new
+    //   one and leave the old one to be freed with its last view
+    u32_t size = old->size;
+    if (unread + bytes > size) {
+        size = unread + bytes;
+    }
+    zjs_buffer_store_t *store_new = zjs_buffer_store_alloc(size);
+    if (!store_new) {
+        return false;
+    }
+    memcpy(store_new->data, *rptr, unread);
+    zjs_buffer_store_release(old);
+    *store = store_new;
+    *rptr = store_new->data;
+    *wptr = store_new->data + unread;
+    return true;
+}
 
 static void zjs_buffer_callback_free(void *handle)
 {
     // requires: handle is the native pointer we registered with
     //             jerry_set_object_native_handle
-    //  effects: frees the buffer item
+    //  effects: frees the buffer item and drops its store reference
     zjs_buffer_t *item = (zjs_buffer_t *)handle;
-    zjs_free(item->buffer);
-    zjs_free(item);
+    zjs_buffer_store_t *store = item->store;
+    bool inline_view = store->inline_view && (void *)store == (void *)(item + 1);
+    zjs_buffer_store_release(store);
+    if (!inline_view) {
+        // otherwise the view's memory goes with the store
+        pool_free(item, sizeof(zjs_buffer_t));
+    }
 }
 
 static const jerry_object_native_info_t buffer_type_info = {
@@ -195,84 +413,562 @@ static ZJS_DECL_FUNC(zjs_buffer_write_uint32_le)
     return zjs_buffer_write_bytes(function_obj, this, argv, argc, 4, false);
 }
 
-char zjs_int_to_hex(int value)
+// element types for the bulk array methods
+typedef enum {
+    ELEMENT_INT8,
+    ELEMENT_UINT8,
+    ELEMENT_INT16,
+    ELEMENT_UINT16,
+    ELEMENT_INT32,
+    ELEMENT_UINT32,
+    ELEMENT_FLOAT32,
+    ELEMENT_FLOAT64
+} element_t;
+
+static const u8_t element_sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+static const jerry_typedarray_type_t element_typedarrays[] = {
+    JERRY_TYPEDARRAY_INT8, JERRY_TYPEDARRAY_UINT8, JERRY_TYPEDARRAY_INT16,
+    JERRY_TYPEDARRAY_UINT16, JERRY_TYPEDARRAY_INT32, JERRY_TYPEDARRAY_UINT32,
+    JERRY_TYPEDARRAY_FLOAT32, JERRY_TYPEDARRAY_FLOAT64
+};
+
+static u8_t *typedarray_data(jerry_value_t value, element_t type,
+                             u32_t *count)
 {
-    // requires: value is between 0 and 15
-    //  effects: returns value as a lowercase hex digit 0-9a-f
-    if (value < 10)
-        return '0' + value;
-    return 'a' + value - 10;
+    // effects: if value is a TypedArray of the given element type, returns a
+    //            pointer to its elements and sets *count; otherwise NULL
+    if (!jerry_value_is_typedarray(value) ||
+        jerry_get_typedarray_type(value) != element_typedarrays[type]) {
+        return NULL;
+    }
+    jerry_length_t offset, length;
+    ZVAL arraybuffer = jerry_get_typedarray_buffer(value, &offset, &length);
+    *count = jerry_get_typedarray_length(value);
+    return jerry_get_arraybuffer_pointer(arraybuffer) + offset;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_to_string)
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_BIG_ENDIAN true
+#else
+#define HOST_BIG_ENDIAN false
+#endif
+
+static double load_element(element_t type, const u8_t *src, bool swap)
 {
-    // requires: this must be a JS buffer object, if an argument is present it
-    //             must be the string 'utf8' (default), 'ascii' or 'hex', as
-    //             those are the only supported encodings for now
-    //  effects: if the buffer object is found, converts its contents to the
-    //             given encoding
+    // effects: returns the element at src, byte swapped first if swap is set;
+    //            memcpy keeps unaligned loads safe and compiles to plain loads
+    u16_t u16;
+    u32_t u32;
+    u64_t u64;
+    switch (type) {
+    case ELEMENT_INT8:
+        return (s8_t)src[0];
+    case ELEMENT_UINT8:
+        return src[0];
+    case ELEMENT_INT16:
+    case ELEMENT_UINT16:
+        memcpy(&u16, src, sizeof(u16));
+        if (swap)
+            u16 = __builtin_bswap16(u16);
+        return (type == ELEMENT_INT16) ? (double)(s16_t)u16 : u16;
+    case ELEMENT_INT32:
+    case ELEMENT_UINT32:
+        memcpy(&u32, src, sizeof(u32));
+        if (swap)
+            u32 = __builtin_bswap32(u32);
+        return (type == ELEMENT_INT32) ? (double)(s32_t)u32 : u32;
+    case ELEMENT_FLOAT32: {
+        float f;
+        memcpy(&u32, src, sizeof(u32));
+        if (swap)
+            u32 = __builtin_bswap32(u32);
+        memcpy(&f, &u32, sizeof(f));
+        return f;
+    }
+    case ELEMENT_FLOAT64: {
+        double d;
+        memcpy(&u64, src, sizeof(u64));
+        if (swap)
+            u64 = __builtin_bswap64(u64);
+        memcpy(&d, &u64, sizeof(d));
+        return d;
+    }
+    }
+    return 0;
+}
 
-    // args: [encoding]
-    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_OPTIONAL Z_STRING);
+static void store_element(element_t type, u8_t *dst, double value, bool swap)
+{
+    // effects: writes value at dst as the given type, byte swapped if swap is
+    //            set; integers wrap around like the single value writes do
+    u32_t u32;
+    u16_t u16;
+    u64_t u64;
+    switch (type) {
+    case ELEMENT_INT8:
+    case ELEMENT_UINT8:
+        dst[0] = (u8_t)(value < 0 ? (s32_t)value : (u32_t)value);
+        return;
+    case ELEMENT_INT16:
+    case ELEMENT_UINT16:
+        u16 = (u16_t)(value < 0 ? (s32_t)value : (u32_t)value);
+        if (swap)
+            u16 = __builtin_bswap16(u16);
+        memcpy(dst, &u16, sizeof(u16));
+        return;
+    case ELEMENT_INT32:
+    case ELEMENT_UINT32:
+        u32 = (u32_t)(value < 0 ? (s32_t)value : value);
+        break;
+    case ELEMENT_FLOAT32: {
+        float f = (float)value;
+        memcpy(&u32, &f, sizeof(u32));
+        break;
+    }
+    case ELEMENT_FLOAT64:
+        memcpy(&u64, &value, sizeof(u64));
+        if (swap)
+            u64 = __builtin_bswap64(u64);
+        memcpy(dst, &u64, sizeof(u64));
+        return;
+    }
+    if (swap)
+        u32 = __builtin_bswap32(u32);
+    memcpy(dst, &u32, sizeof(u32));
+}
+
+static bool get_swap(const jerry_value_t argv[], u32_t argc, u32_t index,
+                     bool *swap)
+{
+    // effects: reads an optional 'LE' or 'BE' argument at index and sets *swap
+    //            if bytes need swapping for this host; returns false if the
+    //            argument is something else
+    bool big_endian = false;
+    if (argc > index && !jerry_value_is_undefined(argv[index])) {
+        char endian[3];
+        jerry_size_t size = sizeof(endian);
+        zjs_copy_jstring(argv[index], endian, &size);
+        if (size && strequal(endian, "BE")) {
+            big_endian = true;
+        } else if (!size || !strequal(endian, "LE")) {
+            return false;
+        }
+    }
+    *swap = (big_endian != HOST_BIG_ENDIAN);
+    return true;
+}
 
-    // TODO: add start and end arguments found in Node
+static ZJS_DECL_FUNC_ARGS(zjs_buffer_read_array, element_t type)
+{
+    // requires: this is a JS buffer object, argv[0] is the offset to start
+    //             reading at, argv[1] is the number of elements, argv[2] is
+    //             an optional 'LE' (default) or 'BE' byte order, and argv[3]
+    //             is an optional array or TypedArray to fill in
+    //  effects: reads count elements of the given type from the buffer into
+    //             a new array, or into the target, and returns it
+
+    // args: offset, count[, endian[, target]]
+    ZJS_VALIDATE_ARGS(Z_NUMBER, Z_NUMBER, Z_OPTIONAL Z_STRING Z_UNDEFINED,
+                      Z_OPTIONAL Z_OBJECT);
 
     zjs_buffer_t *buf = zjs_buffer_find(this);
-    ZJS_ASSERT(buf, "buffer not found");
-    if (!buf) {
-        return zjs_error("not a buffer");
+    if (!buf)
+        return zjs_error("buffer not found on read");
+
+    bool swap;
+    if (!get_swap(argv, argc, 2, &swap))
+        return TYPE_ERROR("endian must be 'LE' or 'BE'");
+
+    u32_t offset = (u32_t)jerry_get_number_value(argv[0]);
+    u32_t count = (u32_t)jerry_get_number_value(argv[1]);
+    u32_t size = element_sizes[type];
+    if (offset > buf->bufsize || count > (buf->bufsize - offset) / size)
+        return zjs_error("read attempted beyond buffer");
+
+    const u8_t *src = buf->buffer + offset;
+    jerry_value_t array;
+    if (argc > 3) {
+        u32_t length;
+        u8_t *data = typedarray_data(argv[3], type, &length);
+        if (data && !swap && length >= count) {
+            // same layout, so just copy the bytes; the array may be a view
+            //   of this buffer's own memory, so the ranges can overlap
+            memmove(data, src, count * size);
+            return jerry_acquire_value(argv[3]);
+        }
+        array = jerry_acquire_value(argv[3]);
+    } else {
+        array = jerry_create_array(count);
+    }
+
+    for (u32_t i = 0; i < count; i++, src += size) {
+        ZVAL num = jerry_create_number(load_element(type, src, swap));
+        jerry_set_property_by_index(array, i, num);
     }
+    return array;
+}
+
+static ZJS_DECL_FUNC_ARGS(zjs_buffer_write_array, element_t type)
+{
+    // requires: this is a JS buffer object, argv[0] is an array or TypedArray
+    //             of numbers, argv[1] is the offset to start writing at, and
+    //             argv[2] is an optional 'LE' (default) or 'BE' byte order
+    //  effects: writes every element of the array into the buffer as the
+    //             given type and returns the offset just beyond them
+
+    // args: values, offset[, endian]
+    ZJS_VALIDATE_ARGS(Z_OBJECT, Z_NUMBER, Z_OPTIONAL Z_STRING Z_UNDEFINED);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("buffer not found on write");
+
+    bool swap;
+    if (!get_swap(argv, argc, 2, &swap))
+        return TYPE_ERROR("endian must be 'LE' or 'BE'");
 
-    const int MAX_ENCODING_LEN = 16;
-    jerry_size_t size = MAX_ENCODING_LEN;
-    char enc[size];
-    const char *encoding = "utf8";
-    if (optcount) {
-        zjs_copy_jstring(argv[0], enc, &size);
-        if (!size) {
-            return zjs_error("encoding argument too long");
+    u32_t count;
+    u8_t *data = typedarray_data(argv[0], type, &count);
+    if (!data) {
+        if (jerry_value_is_array(argv[0])) {
+            count = jerry_get_array_length(argv[0]);
+        } else {
+            ZVAL length = zjs_get_property(argv[0], "length");
+            if (!jerry_value_is_number(length))
+                return TYPE_ERROR("values must be an array");
+            count = (u32_t)jerry_get_number_value(length);
         }
-        encoding = enc;
     }
 
-    if (strequal(encoding, "utf8")) {
-        return jerry_create_string_sz_from_utf8((jerry_char_t *)buf->buffer,
-                                                buf->bufsize);
-    } else if (strequal(encoding, "ascii")) {
-        char *str = zjs_malloc(buf->bufsize);
-        if (!str) {
-            return zjs_error("out of memory");
+    u32_t offset = (u32_t)jerry_get_number_value(argv[1]);
+    u32_t size = element_sizes[type];
+    if (offset > buf->bufsize || count > (buf->bufsize - offset) / size)
+        return zjs_error("write attempted beyond buffer");
+
+    u8_t *dst = buf->buffer + offset;
+    if (data && !swap) {
+        // same layout, so just copy the bytes; the array may be a view of
+        //   this buffer's own memory, so the ranges can overlap
+        memmove(dst, data, count * size);
+        return jerry_create_number(offset + count * size);
+    }
+    for (u32_t i = 0; i < count; i++, dst += size) {
+        ZVAL item = jerry_get_property_by_index(argv[0], i);
+        double value = 0;
+        if (jerry_value_is_number(item))
+            value = jerry_get_number_value(item);
+        store_element(type, dst, value, swap);
+    }
+    return jerry_create_number(offset + count * size);
+}
+
+#define DECL_ARRAY_FUNCS(name, type)                                    \
+    static ZJS_DECL_FUNC(zjs_buffer_read_##name##_array)                \
+    {                                                                   \
+        return zjs_buffer_read_array(function_obj, this, argv, argc,    \
+                                     type);                             \
+    }                                                                   \
+    static ZJS_DECL_FUNC(zjs_buffer_write_##name##_array)               \
+    {                                                                   \
+        return zjs_buffer_write_array(function_obj, this, argv, argc,   \
+                                      type);                            \
+    }
+
+DECL_ARRAY_FUNCS(int8, ELEMENT_INT8)
+DECL_ARRAY_FUNCS(uint8, ELEMENT_UINT8)
+DECL_ARRAY_FUNCS(int16, ELEMENT_INT16)
+DECL_ARRAY_FUNCS(uint16, ELEMENT_UINT16)
+DECL_ARRAY_FUNCS(int32, ELEMENT_INT32)
+DECL_ARRAY_FUNCS(uint32, ELEMENT_UINT32)
+DECL_ARRAY_FUNCS(float32, ELEMENT_FLOAT32)
+DECL_ARRAY_FUNCS(float64, ELEMENT_FLOAT64)
+
+typedef enum {
+    ENCODING_UTF8,
+    ENCODING_ASCII,
+    ENCODING_LATIN1,
+    ENCODING_HEX,
+    ENCODING_BASE64,
+    ENCODING_INVALID
+} encoding_t;
+
+static const struct {
+    const char *name;
+    encoding_t encoding;
+} encodings[] = {
+    { "utf8", ENCODING_UTF8 },
+    { "utf-8", ENCODING_UTF8 },
+    { "ascii", ENCODING_ASCII },
+    { "latin1", ENCODING_LATIN1 },
+    { "binary", ENCODING_LATIN1 },
+    { "hex", ENCODING_HEX },
+    { "base64", ENCODING_BASE64 },
+};
+
+// the codecs are plain table-driven C shared by every target; the Zephyr
+//   boards have no portable SIMD, so there are no vector paths to keep in step
+static const char hex_digits[] = "0123456789abcdef";
+static const char base64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// maps 7-bit characters to their base64 value, accepting the URL-safe
+//   alphabet too; XX marks characters that aren't base64 digits
+#define XX 0xff
+static const u8_t base64_values[128] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, 62, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, XX, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, 63,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+};
+#undef XX
+
+static encoding_t get_encoding(jerry_value_t value)
+{
+    // requires: value is a JS string
+    //  effects: returns the matching encoding, or ENCODING_INVALID
+    char name[8];
+    jerry_size_t size = sizeof(name);
+    zjs_copy_jstring(value, name, &size);
+    if (!size) {
+        return ENCODING_INVALID;
+    }
+    for (int i = 0; i < sizeof(encodings) / sizeof(encodings[0]); i++) {
+        if (strequal(name, encodings[i].name)) {
+            return encodings[i].encoding;
         }
+    }
+    return ENCODING_INVALID;
+}
+
+static int hex_value(u8_t c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;  // lowercase
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static jerry_value_t encode_string(encoding_t encoding, const u8_t *data,
+                                   u32_t len)
+{
+    // effects: returns a JS string with len bytes from data encoded as given
+    if (encoding == ENCODING_UTF8) {
+        return jerry_create_string_sz_from_utf8((jerry_char_t *)data, len);
+    }
+    if (!len) {
+        return jerry_create_string((jerry_char_t *)"");
+    }
+
+    // worst case output size for each encoding
+    u32_t size = len * 2;
+    if (encoding == ENCODING_ASCII) {
+        size = len;
+    } else if (encoding == ENCODING_BASE64) {
+        size = (len + 2) / 3 * 4;
+    }
+    u8_t *str = zjs_malloc(size);
+    if (!str) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
 
-        int len;
-        for (len = 0; len < buf->bufsize; ++len) {
+    u8_t *out = str;
+    u32_t i = 0;
+    switch (encoding) {
+    case ENCODING_ASCII:
+        for (; i < len; i++) {
             // strip off high bit if present
-            str[len] = buf->buffer[len] & 0x7f;
-            if (!str[len]) {
+            *out = data[i] & 0x7f;
+            if (!*out) {
                 break;
             }
+            out++;
+        }
+        break;
+
+    case ENCODING_LATIN1:
+        // each byte is a code point; the upper half takes two UTF-8 bytes
+        for (; i < len; i++) {
+            u8_t byte = data[i];
+            if (byte < 0x80) {
+                *out++ = byte;
+            } else {
+                *out++ = 0xc0 | (byte >> 6);
+                *out++ = 0x80 | (byte & 0x3f);
+            }
         }
+        break;
 
-        jerry_value_t jstr;
-        jstr = jerry_create_string_sz_from_utf8((jerry_char_t *)str, len);
-        zjs_free(str);
-        return jstr;
-    } else if (strequal(encoding, "hex")) {
-        if (buf && buf->bufsize > 0) {
-            char hexbuf[buf->bufsize * 2 + 1];
-            for (int i = 0; i < buf->bufsize; i++) {
-                int high = (0xf0 & buf->buffer[i]) >> 4;
-                int low = 0xf & buf->buffer[i];
-                hexbuf[2 * i] = zjs_int_to_hex(high);
-                hexbuf[2 * i + 1] = zjs_int_to_hex(low);
+    case ENCODING_HEX:
+        for (; i < len; i++) {
+            *out++ = hex_digits[data[i] >> 4];
+            *out++ = hex_digits[data[i] & 0xf];
+        }
+        break;
+
+    case ENCODING_BASE64:
+        // three bytes at a time make four digits
+        for (; i + 3 <= len; i += 3) {
+            u32_t bits = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            *out++ = base64_digits[bits >> 18];
+            *out++ = base64_digits[(bits >> 12) & 0x3f];
+            *out++ = base64_digits[(bits >> 6) & 0x3f];
+            *out++ = base64_digits[bits & 0x3f];
+        }
+        if (i < len) {
+            u32_t bits = data[i] << 16;
+            if (i + 1 < len) {
+                bits |= data[i + 1] << 8;
             }
-            hexbuf[buf->bufsize * 2] = '\0';
-            return jerry_create_string((jerry_char_t *)hexbuf);
+            *out++ = base64_digits[bits >> 18];
+            *out++ = base64_digits[(bits >> 12) & 0x3f];
+            *out++ = (i + 1 < len) ? base64_digits[(bits >> 6) & 0x3f] : '=';
+            *out++ = '=';
         }
-    } else {
-        return zjs_error("unsupported encoding type");
+        break;
+
+    default:
+        break;
     }
-    return zjs_error("buffer is empty");
+
+    jerry_value_t jstr =
+        jerry_create_string_sz_from_utf8((jerry_char_t *)str, out - str);
+    zjs_free(str);
+    return jstr;
+}
+
+static u32_t decode_string(encoding_t encoding, u8_t *str, u32_t len)
+{
+    // requires: str holds len bytes of UTF-8 from a JS string
+    //  effects: decodes str in place, which works because no encoding takes
+    //             fewer characters than the bytes they stand for; returns the
+    //             decoded length, stopping early at invalid input as Node does
+    u8_t *out = str;
+    u32_t i = 0;
+    switch (encoding) {
+    case ENCODING_ASCII:
+    case ENCODING_LATIN1:
+        // keep the low byte of each character code
+        while (i < len) {
+            u8_t byte = str[i++];
+            u32_t code = byte;
+            int extra = 0;
+            if (byte >= 0xf0) {
+                code = byte & 0x07;
+                extra = 3;
+            } else if (byte >= 0xe0) {
+                code = byte & 0x0f;
+                extra = 2;
+            } else if (byte >= 0xc0) {
+                code = byte & 0x1f;
+                extra = 1;
+            }
+            for (; extra && i < len; extra--) {
+                code = (code << 6) | (str[i++] & 0x3f);
+            }
+            *out++ = (u8_t)code;
+        }
+        break;
+
+    case ENCODING_HEX:
+        for (; i + 2 <= len; i += 2) {
+            int high = hex_value(str[i]);
+            int low = hex_value(str[i + 1]);
+            if (high < 0 || low < 0) {
+                break;
+            }
+            *out++ = (high << 4) | low;
+        }
+        break;
+
+    case ENCODING_BASE64: {
+        // skips whitespace and other non-digits, and stops at padding
+        u32_t bits = 0;
+        int count = 0;
+        for (; i < len && str[i] != '='; i++) {
+            u8_t value = (str[i] < 0x80) ? base64_values[str[i]] : 0xff;
+            if (value == 0xff) {
+                continue;
+            }
+            bits = (bits << 6) | value;
+            count += 6;
+            if (count >= 8) {
+                count -= 8;
+                *out++ = (u8_t)(bits >> count);
+            }
+        }
+        break;
+    }
+
+    default:
+        return len;
+    }
+    return out - str;
+}
+
+static u8_t *alloc_decoded(jerry_value_t jstr, encoding_t encoding,
+                           u32_t *len)
+{
+    // requires: jstr is a JS string
+    //  effects: returns a new heap buffer holding the bytes jstr stands for
+    //             in the given encoding and sets *len to their count, or
+    //             returns NULL if out of memory
+    jerry_size_t size = 0;
+    u8_t *str = (u8_t *)zjs_alloc_from_jstring(jstr, &size);
+    if (str) {
+        *len = decode_string(encoding, str, size);
+    }
+    return str;
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_to_string)
+{
+    // requires: this must be a JS buffer object, if an argument is present it
+    //             must be one of the encodings 'utf8' (default), 'ascii',
+    //             'latin1', 'hex' or 'base64'; start and end may select part
+    //             of the buffer
+    //  effects: if the buffer object is found, converts its contents from
+    //             start to end (not inclusive) to the given encoding
+
+    // args: [encoding[, start[, end]]]
+    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_OPTIONAL Z_STRING Z_UNDEFINED,
+                               Z_OPTIONAL Z_NUMBER Z_UNDEFINED,
+                               Z_OPTIONAL Z_NUMBER Z_UNDEFINED);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    ZJS_ASSERT(buf, "buffer not found");
+    if (!buf) {
+        return zjs_error("not a buffer");
+    }
+
+    encoding_t encoding = ENCODING_UTF8;
+    if (optcount >= 1 && !jerry_value_is_undefined(argv[0])) {
+        encoding = get_encoding(argv[0]);
+        if (encoding == ENCODING_INVALID) {
+            return zjs_error("unsupported encoding type");
+        }
+    }
+
+    u32_t start = 0;
+    u32_t end = buf->bufsize;
+    if (optcount >= 2 && !jerry_value_is_undefined(argv[1])) {
+        double dstart = jerry_get_number_value(argv[1]);
+        start = (dstart < 0) ? 0 : (dstart > end) ? end : (u32_t)dstart;
+    }
+    if (optcount >= 3 && !jerry_value_is_undefined(argv[2])) {
+        double dend = jerry_get_number_value(argv[2]);
+        if (dend < end) {
+            end = (dend < start) ? start : (u32_t)dend;
+        }
+    }
+
+    return encode_string(encoding, buf->buffer + start, end - start);
 }
 
 static ZJS_DECL_FUNC(zjs_buffer_copy)
@@ -322,18 +1018,66 @@ static ZJS_DECL_FUNC(zjs_buffer_copy)
         return zjs_error("target buffer insufficient");
     }
 
+    // slices share their parent's store, so like Node allow the source and
+    //   target ranges to overlap
     int len = sourceEnd - sourceStart;
-    memcpy(target->buffer + targetStart, source->buffer + sourceStart, len);
+    memmove(target->buffer + targetStart, source->buffer + sourceStart, len);
     return jerry_create_number(len);
 }
 
+static u32_t clamp_index(jerry_value_t value, u32_t length)
+{
+    // effects: converts a Node-style slice index to an offset, counting
+    //            negative values back from length and clamping to the buffer
+    double index = jerry_get_number_value(value);
+    if (index < 0) {
+        index += length;
+        if (index < 0) {
+            return 0;
+        }
+    }
+    return (index > length) ? length : (u32_t)index;
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_slice)
+{
+    // requires: this must be a JS buffer object
+    //  effects: returns a new Buffer sharing the bytes of this one from start
+    //             to end (not inclusive), without copying them
+
+    // args: [start], [end]
+    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_OPTIONAL Z_NUMBER Z_UNDEFINED,
+                               Z_OPTIONAL Z_NUMBER Z_UNDEFINED);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return zjs_error("buffer not found");
+    }
+
+    u32_t start = 0;
+    u32_t end = buf->bufsize;
+    if (optcount >= 1 && !jerry_value_is_undefined(argv[0])) {
+        start = clamp_index(argv[0], buf->bufsize);
+    }
+    if (optcount >= 2 && !jerry_value_is_undefined(argv[1])) {
+        end = clamp_index(argv[1], buf->bufsize);
+    }
+    if (end < start) {
+        end = start;
+    }
+
+    u32_t offset = buf->buffer - buf->store->data;
+    return zjs_buffer_create_view(buf->store, offset + start, end - start,
+                                  NULL);
+}
+
 static ZJS_DECL_FUNC(zjs_buffer_write_string)
 {
     // requires: string - what will be written to buf
     //           offset - where to start writing (Default: 0)
-    //           length - how many bytes to write (Default: buf.length -offset)
-    //           encoding - the character encoding of string. Currently only
-    //             supports the default of utf8
+    //           length - how many bytes to write (Default: buf.length -offset,
+    //             or less if the string is shorter)
+    //           encoding - the character encoding of string (Default: utf8)
     //  effects: writes string to buf at offset according to the character
     //             encoding in encoding.
 
@@ -346,36 +1090,33 @@ static ZJS_DECL_FUNC(zjs_buffer_write_string)
         return zjs_error("buffer not found");
     }
 
-    // Check if the encoding string is anything other than utf8
+    encoding_t encoding = ENCODING_UTF8;
     if (argc > 3) {
-        char *encoding = zjs_alloc_from_jstring(argv[3], NULL);
-        if (!encoding) {
-            return zjs_error("out of memory");
+        encoding = get_encoding(argv[3]);
+        if (encoding == ENCODING_INVALID) {
+            return NOTSUPPORTED_ERROR("unsupported encoding type");
         }
+    }
 
-        // ask for one more char than needed to make sure not just prefix match
-        const char *utf8_encoding = "utf8";
-        int utf8_len = strlen(utf8_encoding);
-        int rval = strncmp(encoding, utf8_encoding, utf8_len + 1);
-        zjs_free(encoding);
-        if (rval != 0) {
-            return NOTSUPPORTED_ERROR("only utf8 encoding supported");
-        }
+    u32_t offset = 0;
+    if (argc > 1)
+        offset = (u32_t)jerry_get_number_value(argv[1]);
+    if (offset > buf->bufsize) {
+        return zjs_error("offset beyond buffer");
     }
 
-    jerry_size_t size = 0;
-    char *str = zjs_alloc_from_jstring(argv[0], &size);
+    u32_t size;
+    u8_t *str = alloc_decoded(argv[0], encoding, &size);
     if (!str) {
         return zjs_error("out of memory");
     }
 
-    u32_t offset = 0;
-    if (argc > 1)
-        offset = (u32_t)jerry_get_number_value(argv[1]);
-
     u32_t length = buf->bufsize - offset;
-    if (argc > 2)
+    if (argc > 2) {
         length = (u32_t)jerry_get_number_value(argv[2]);
+    } else if (length > size) {
+        length = size;
+    }
 
     if (length > size) {
         zjs_free(str);
@@ -398,8 +1139,7 @@ static ZJS_DECL_FUNC(zjs_buffer_fill)
     // requires: value - what will be written to buf
     //           offset - where to start writing (Default: 0)
     //           end - offset at which to stop writing (Default: buf.length)
-    //           encoding - the character encoding of value. Currently only
-    //             supports the default of utf8
+    //           encoding - the character encoding of value (Default: utf8)
     //  effects: writes string to buf at offset according to the character
     //             encoding in encoding.
 
@@ -407,8 +1147,6 @@ static ZJS_DECL_FUNC(zjs_buffer_fill)
     ZJS_VALIDATE_ARGS(Z_STRING Z_NUMBER Z_BUFFER, Z_OPTIONAL Z_NUMBER,
                       Z_OPTIONAL Z_NUMBER, Z_OPTIONAL Z_STRING);
 
-    // TODO: support encodings other than 'utf8'
-
     u32_t num;
     char *source = NULL;
     char *str = NULL;
@@ -435,20 +1173,11 @@ static ZJS_DECL_FUNC(zjs_buffer_fill)
         return zjs_error("buffer not found");
     }
 
-    // Check if the encoding string is anything other than utf8
+    encoding_t encoding = ENCODING_UTF8;
     if (argc > 3) {
-        char *encoding = zjs_alloc_from_jstring(argv[3], NULL);
-        if (!encoding) {
-            return zjs_error("out of memory");
-        }
-
-        // ask for one more char than needed to make sure not just prefix match
-        const char *utf8_encoding = "utf8";
-        int utf8_len = strlen(utf8_encoding);
-        int rval = strncmp(encoding, utf8_encoding, utf8_len + 1);
-        zjs_free(encoding);
-        if (rval != 0) {
-            return NOTSUPPORTED_ERROR("only utf8 encoding supported");
+        encoding = get_encoding(argv[3]);
+        if (encoding == ENCODING_INVALID) {
+            return NOTSUPPORTED_ERROR("unsupported encoding type");
         }
     }
 
@@ -470,13 +1199,18 @@ static ZJS_DECL_FUNC(zjs_buffer_fill)
     }
 
     if (jerry_value_is_string(argv[0])) {
-        jerry_size_t size = 0;
-        char *str = zjs_alloc_from_jstring(argv[0], &size);
+        str = (char *)alloc_decoded(argv[0], encoding, &srclen);
         if (!str) {
             return zjs_error("out of memory");
         }
         source = str;
-        srclen = size;
+    }
+
+    if (!srclen) {
+        // like Node, fill with zeros when there's nothing to repeat
+        memset(buf->buffer + offset, 0, end - offset);
+        zjs_free(str);
+        return jerry_acquire_value(this);
     }
 
     u32_t bytes_left = end - offset;
@@ -494,12 +1228,64 @@ static ZJS_DECL_FUNC(zjs_buffer_fill)
     return jerry_acquire_value(this);
 }
 
+static jerry_value_t create_object(zjs_buffer_t *buf_item,
+                                   zjs_buffer_store_t *store, u32_t offset,
+                                   u32_t length, zjs_buffer_t **ret_buf)
+{
+    // requires: buf_item is allocated and owns a reference to store
+    //  effects: fills in buf_item and creates the JS Buffer object for it
+    jerry_value_t buf_obj = zjs_create_object();
+    buf_item->buffer = store->data + offset;
+    buf_item->bufsize = length;
+    buf_item->store = store;
+
+    // modules create buffers before the app ever touches the Buffer global
+    if (!zjs_buffer_prototype) {
+        init_prototype();
+    }
+    jerry_set_prototype(buf_obj, zjs_buffer_prototype);
+    zjs_obj_add_readonly_number(buf_obj, "length", length);
+
+    // watch for the object getting garbage collected, and clean up
+    jerry_set_object_native_pointer(buf_obj, buf_item, &buffer_type_info);
+    if (ret_buf) {
+        *ret_buf = buf_item;
+    }
+    return buf_obj;
+}
+
+jerry_value_t zjs_buffer_create_view(zjs_buffer_store_t *store, u32_t offset,
+                                     u32_t length, zjs_buffer_t **ret_buf)
+{
+    // requires: offset + length is within store
+    //  effects: allocates a JS Buffer object and a handle viewing length bytes
+    //             of store at offset, taking a reference to store; if this
+    //             fails, return an error; otherwise return the JS object
+    if (ret_buf) {
+        *ret_buf = NULL;
+    }
+    if (offset > store->size || length > store->size - offset) {
+        return zjs_standard_error(RangeError, "view outside of buffer", 0, 0);
+    }
+
+    zjs_buffer_t *buf_item = (zjs_buffer_t *)pool_alloc(sizeof(zjs_buffer_t));
+    if (!buf_item) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+
+    return create_object(buf_item, zjs_buffer_store_acquire(store), offset,
+                         length, ret_buf);
+}
+
 jerry_value_t zjs_buffer_create(u32_t size, zjs_buffer_t **ret_buf)
 {
     // requires: size is size of desired buffer, in bytes
-    //  effects: allocates a JS Buffer object, an underlying C buffer, and a
-    //             list item to track it; if any of these fail, return an error;
+    //  effects: allocates a JS Buffer object, an underlying backing store, and
+    //             a handle to track it; if any of these fail, return an error;
     //             otherwise return the JS object
+    if (ret_buf) {
+        *ret_buf = NULL;
+    }
 
     // follow Node's Buffer.kMaxLength limits though we don't expose that
     u32_t maxLength = (1UL << 31) - 1;
@@ -513,46 +1299,126 @@ jerry_value_t zjs_buffer_create(u32_t size, zjs_buffer_t **ret_buf)
                                   0);
     }
 
-    void *buf = zjs_malloc(size);
-    zjs_buffer_t *buf_item = (zjs_buffer_t *)zjs_malloc(sizeof(zjs_buffer_t));
-
-    if (!buf || !buf_item) {
-        zjs_free(buf);
-        zjs_free(buf_item);
-        if (ret_buf) {
-            *ret_buf = NULL;
+    if (pool_class(INLINE_BLOCK_SIZE(size)) >= 0) {
+        // small enough to keep the view, store and data in one pool block
+        zjs_buffer_t *buf_item =
+            (zjs_buffer_t *)pool_alloc(INLINE_BLOCK_SIZE(size));
+        if (!buf_item) {
+            return zjs_error_context("out of memory", 0, 0);
         }
+        zjs_buffer_store_t *store = (zjs_buffer_store_t *)(buf_item + 1);
+        store->refcount = 1;
+        store->size = size;
+        store->inline_view = 1;
+        store->data = (u8_t *)(store + 1);
+        store->owner = ZJS_UNDEFINED;
+        return create_object(buf_item, store, 0, size, ret_buf);
+    }
+
+    zjs_buffer_store_t *store = zjs_buffer_store_alloc(size);
+    if (!store) {
         return zjs_error_context("out of memory", 0, 0);
     }
 
-    jerry_value_t buf_obj = zjs_create_object();
-    buf_item->buffer = buf;
-    buf_item->bufsize = size;
+    // the new view holds the only reference we keep
+    jerry_value_t buf_obj = zjs_buffer_create_view(store, 0, size, ret_buf);
+    zjs_buffer_store_release(store);
+    return buf_obj;
+}
 
-    jerry_set_prototype(buf_obj, zjs_buffer_prototype);
-    zjs_obj_add_readonly_number(buf_obj, "length", size);
+static ZJS_DECL_FUNC(zjs_buffer_get_arraybuffer)
+{
+    // requires: this must be a JS buffer object
+    //  effects: returns an ArrayBuffer sharing the memory of the buffer's
+    //             backing store, caching it on the object so it stays the
+    //             same ArrayBuffer on later reads
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return ZJS_UNDEFINED;
+    }
 
-    // watch for the object getting garbage collected, and clean up
-    jerry_set_object_native_pointer(buf_obj, buf_item, &buffer_type_info);
-    if (ret_buf) {
-        *ret_buf = buf_item;
+    jerry_value_t arraybuffer = zjs_buffer_store_to_arraybuffer(buf->store);
+    if (!jerry_value_is_error(arraybuffer)) {
+        zjs_set_readonly_property(this, "buffer", arraybuffer);
+    }
+    return arraybuffer;
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_get_byte_offset)
+{
+    // requires: this must be a JS buffer object
+    //  effects: returns the offset of the buffer within its ArrayBuffer
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return ZJS_UNDEFINED;
+    }
+    return jerry_create_number(buf->buffer - buf->store->data);
+}
+
+static void add_getter(jerry_value_t obj, const char *name,
+                       jerry_external_handler_t getter)
+{
+    // effects: defines a readonly accessor property on obj
+    ZVAL jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_property_descriptor_t pd;
+    jerry_init_property_descriptor_fields(&pd);
+    pd.is_get_defined = true;
+    pd.getter = jerry_create_external_function(getter);
+    pd.is_configurable_defined = true;
+    pd.is_configurable = true;
+    ZVAL result = jerry_define_own_property(obj, jname, &pd);
+    jerry_free_property_descriptor_fields(&pd);
+}
+
+static jerry_value_t create_from_arraybuffer(const jerry_value_t argv[],
+                                             u32_t argc)
+{
+    // requires: argv[0] is an ArrayBuffer, argv[1] and argv[2] are optional
+    //             byte offset and length numbers
+    //  effects: returns a new Buffer sharing the ArrayBuffer's memory
+    u32_t size = jerry_get_arraybuffer_byte_length(argv[0]);
+    u32_t offset = 0;
+    if (argc > 1) {
+        if (!jerry_value_is_number(argv[1])) {
+            return zjs_error_context("invalid byte offset", 0, 0);
+        }
+        offset = (u32_t)jerry_get_number_value(argv[1]);
+    }
+    if (offset > size) {
+        return zjs_standard_error(RangeError, "byte offset out of range", 0, 0);
+    }
+    u32_t length = size - offset;
+    if (argc > 2) {
+        length = (u32_t)jerry_get_number_value(argv[2]);
+    }
+
+    zjs_buffer_store_t *store = zjs_buffer_store_wrap(argv[0]);
+    if (!store) {
+        return zjs_error_context("out of memory", 0, 0);
     }
+    jerry_value_t buf_obj = zjs_buffer_create_view(store, offset, length, NULL);
+    zjs_buffer_store_release(store);
     return buf_obj;
 }
 
 // Buffer constructor
 static ZJS_DECL_FUNC(zjs_buffer)
 {
-    // requires: single argument can be a numeric size in bytes, an array of
-    //             uint8s, or a string
+    // requires: first argument can be a numeric size in bytes, an array of
+    //             uint8s, a string with an optional encoding, or an
+    //             ArrayBuffer with optional byte offset and length
     //  effects: constructs a new JS Buffer object, and an associated buffer
     //             tied to it through a zjs_buffer_t struct stored in a global
     //             list
 
-    // args: initial size or initialization data
-    ZJS_VALIDATE_ARGS(Z_NUMBER Z_ARRAY Z_STRING);
+    // args: initial size or initialization data[, encoding or byte offset
+    //         [, length]]
+    ZJS_VALIDATE_ARGS(Z_NUMBER Z_ARRAY Z_STRING Z_OBJECT,
+                      Z_OPTIONAL Z_STRING Z_NUMBER, Z_OPTIONAL Z_NUMBER);
 
-    if (jerry_value_is_number(argv[0])) {
+    if (jerry_value_is_arraybuffer(argv[0])) {
+        return create_from_arraybuffer(argv, argc);
+    } else if (jerry_value_is_number(argv[0])) {
         double dnum = jerry_get_number_value(argv[0]);
         u32_t unum;
         if (dnum < 0) {
@@ -585,11 +1451,21 @@ static ZJS_DECL_FUNC(zjs_buffer)
             }
         }
         return new_buf;
-    } else {
-        // FIXME: this should take an encoding too
+    } else if (jerry_value_is_string(argv[0])) {
         // treat string argument as initializer
-        jerry_size_t size = 0;
-        char *str = zjs_alloc_from_jstring(argv[0], &size);
+        encoding_t encoding = ENCODING_UTF8;
+        if (argc > 1) {
+            if (!jerry_value_is_string(argv[1])) {
+                return TYPE_ERROR("encoding must be a string");
+            }
+            encoding = get_encoding(argv[1]);
+            if (encoding == ENCODING_INVALID) {
+                return NOTSUPPORTED_ERROR("unsupported encoding type");
+            }
+        }
+
+        u32_t size;
+        u8_t *str = alloc_decoded(argv[0], encoding, &size);
         if (!str) {
             return zjs_error("could not allocate string");
         }
@@ -603,13 +1479,11 @@ static ZJS_DECL_FUNC(zjs_buffer)
         zjs_free(str);
         return new_buf;
     }
+    return TYPE_ERROR("invalid arguments");
 }
 
-void zjs_buffer_init()
+static void init_prototype()
 {
-    ZVAL global_obj = jerry_get_global_object();
-    zjs_obj_add_function(global_obj, "Buffer", zjs_buffer);
-
     zjs_native_func_t array[] = {
         { zjs_buffer_read_uint8, "readUInt8" },
         { zjs_buffer_write_uint8, "writeUInt8" },
@@ -621,18 +1495,50 @@ void zjs_buffer_init()
         { zjs_buffer_write_uint32_be, "writeUInt32BE" },
         { zjs_buffer_read_uint32_le, "readUInt32LE" },
         { zjs_buffer_write_uint32_le, "writeUInt32LE" },
+        { zjs_buffer_read_int8_array, "readInt8Array" },
+        { zjs_buffer_write_int8_array, "writeInt8Array" },
+        { zjs_buffer_read_uint8_array, "readUInt8Array" },
+        { zjs_buffer_write_uint8_array, "writeUInt8Array" },
+        { zjs_buffer_read_int16_array, "readInt16Array" },
+        { zjs_buffer_write_int16_array, "writeInt16Array" },
+        { zjs_buffer_read_uint16_array, "readUInt16Array" },
+        { zjs_buffer_write_uint16_array, "writeUInt16Array" },
+        { zjs_buffer_read_int32_array, "readInt32Array" },
+        { zjs_buffer_write_int32_array, "writeInt32Array" },
+        { zjs_buffer_read_uint32_array, "readUInt32Array" },
+        { zjs_buffer_write_uint32_array, "writeUInt32Array" },
+        { zjs_buffer_read_float32_array, "readFloat32Array" },
+        { zjs_buffer_write_float32_array, "writeFloat32Array" },
+        { zjs_buffer_read_float64_array, "readFloat64Array" },
+        { zjs_buffer_write_float64_array, "writeFloat64Array" },
         { zjs_buffer_copy, "copy" },
         { zjs_buffer_fill, "fill" },
+        { zjs_buffer_slice, "slice" },
+        { zjs_buffer_slice, "subarray" },
         { zjs_buffer_to_string, "toString" },
         { zjs_buffer_write_string, "write" },
         { NULL, NULL }
     };
     zjs_buffer_prototype = zjs_create_object();
     zjs_obj_add_functions(zjs_buffer_prototype, array);
+    add_getter(zjs_buffer_prototype, "buffer", zjs_buffer_get_arraybuffer);
+    add_getter(zjs_buffer_prototype, "byteOffset", zjs_buffer_get_byte_offset);
+}
+
+void zjs_buffer_init()
+{
+    ZVAL global_obj = jerry_get_global_object();
+    zjs_obj_add_function(global_obj, "Buffer", zjs_buffer);
+
+    if (!zjs_buffer_prototype) {
+        init_prototype();
+    }
 }
 
 void zjs_buffer_cleanup()
 {
+    // the module may never have been initialized, see zjs_modules_init
     jerry_release_value(zjs_buffer_prototype);
+    zjs_buffer_prototype = 0;
 }
 #endif  // BUILD_MODULE_BUFFER
@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef __zjs_buffer_h__
 #define __zjs_buffer_h__
@@ -14,12 +14,140 @@ void zjs_buffer_init();
 /** Release resources held by the buffer module */
 void zjs_buffer_cleanup();
 
+/*
+ * Buffer memory lives in refcounted backing stores. Every Buffer object is a
+ * view onto part of a store and holds a reference to it, so slices share the
+ * bytes of their parent instead of copying them; the store is freed when the
+ * last view is collected. C code that owns a store, such as a socket receive
+ * buffer, holds its own reference and can hand out views of it to JS.
+ *
+ * Where JerryScript has TypedArray support, a store can also wrap the memory
+ * of an ArrayBuffer, and buf.buffer exposes a store to JS as an external
+ * ArrayBuffer, so Buffers and TypedArrays can share bytes without copying.
+ */
+typedef struct zjs_buffer_store {
+    u32_t refcount;
+    u32_t size;           // size of data in bytes
+    u32_t inline_view;    // nonzero if allocated in one block with its first view
+    u8_t *data;           // the bytes, which follow this struct unless owned
+    jerry_value_t owner;  // ArrayBuffer that owns data, or undefined
+} zjs_buffer_store_t;
+
 // FIXME: We should make this private and have accessor methods
 typedef struct zjs_buffer {
-    u8_t *buffer;
-    u32_t bufsize;
+    u8_t *buffer;                 // first byte of this view, within store
+    u32_t bufsize;                // length of this view in bytes
+    zjs_buffer_store_t *store;
 } zjs_buffer_t;
 
+/*
+ * Stores and views are allocated from a pool of power-of-two size classes,
+ * carved on demand from a static arena of ZJS_BUFFER_POOL_SIZE bytes and
+ * recycled through per-class free lists, so the per-packet Buffers created by
+ * I/O modules don't fragment the heap. A new Buffer small enough for a class
+ * gets its view, store and data in a single block. Larger requests, and any
+ * made once the arena is used up, fall back to the heap.
+ */
+#ifndef ZJS_BUFFER_POOL_SIZE
+#ifdef ZJS_LINUX_BUILD
+#define ZJS_BUFFER_POOL_SIZE 32768
+#else
+#define ZJS_BUFFER_POOL_SIZE 2048
+#endif
+#endif
+
+#define ZJS_BUFFER_POOL_MIN_BLOCK 32
+#ifdef ZJS_LINUX_BUILD
+#define ZJS_BUFFER_POOL_CLASSES 7   // 32 to 2048 byte blocks
+#else
+#define ZJS_BUFFER_POOL_CLASSES 5   // 32 to 512 byte blocks
+#endif
+
+typedef struct zjs_buffer_pool_stats {
+    u32_t block_size;   // size of blocks in this class
+    u32_t blocks;       // blocks carved from the arena for this class
+    u32_t in_use;       // blocks currently allocated
+    u32_t peak;         // most blocks allocated at once
+    u32_t allocs;       // total allocations served from the pool
+    u32_t misses;       // allocations that fell back to the heap
+} zjs_buffer_pool_stats_t;
+
+/**
+ * Get the counters for one pool size class
+ *
+ * @param index  Size class, from 0 to ZJS_BUFFER_POOL_CLASSES - 1
+ * @param stats  Receives the counters
+ *
+ * @return  false if index is out of range
+ */
+bool zjs_get_buffer_pool_stats(u32_t index, zjs_buffer_pool_stats_t *stats);
+
+/**
+ * Print a table of the pool counters
+ */
+void zjs_print_buffer_pool_stats(void);
+
+/**
+ * Allocate a new backing store
+ *
+ * @param size  Size in bytes
+ *
+ * @return  New store with one reference owned by the caller, or NULL
+ */
+zjs_buffer_store_t *zjs_buffer_store_alloc(u32_t size);
+
+/**
+ * Take an additional reference to a backing store
+ *
+ * @param store  A backing store
+ *
+ * @return  The same store
+ */
+zjs_buffer_store_t *zjs_buffer_store_acquire(zjs_buffer_store_t *store);
+
+/**
+ * Drop a reference to a backing store, freeing it with the last one
+ *
+ * @param store  A backing store, or NULL
+ */
+void zjs_buffer_store_release(zjs_buffer_store_t *store);
+
+/**
+ * Create a backing store sharing the memory of an ArrayBuffer
+ *
+ * @param arraybuffer  An ArrayBuffer, which the store keeps alive
+ *
+ * @return  New store with one reference owned by the caller, or NULL
+ */
+zjs_buffer_store_t *zjs_buffer_store_wrap(jerry_value_t arraybuffer);
+
+/**
+ * Get an ArrayBuffer sharing the memory of a backing store
+ *
+ * @param store  A backing store, which the ArrayBuffer keeps alive
+ *
+ * @return  New reference to an ArrayBuffer over all of store's data, or an
+ *            Error object if TypedArrays are not supported
+ */
+jerry_value_t zjs_buffer_store_to_arraybuffer(zjs_buffer_store_t *store);
+
+/**
+ * Make room to append to a store used as a stream read buffer
+ *
+ * Unread data between *rptr and *wptr is kept. While the store is not shared
+ * it is reused from the start; once JS holds views of it, a new store is
+ * allocated instead so those views are never overwritten.
+ *
+ * @param store  Pointer to the caller's store reference, may be replaced
+ * @param rptr   Pointer to the read position within the store, may move
+ * @param wptr   Pointer to the write position within the store, may move
+ * @param bytes  Number of bytes about to be written at *wptr
+ *
+ * @return  true if there is room, false if out of memory
+ */
+bool zjs_buffer_store_reserve(zjs_buffer_store_t **store, u8_t **rptr,
+                              u8_t **wptr, u32_t bytes);
+
 /**
  * Test whether the given value is a Buffer object
  *
@@ -49,4 +177,18 @@ zjs_buffer_t *zjs_buffer_find(const jerry_value_t obj);
  */
 jerry_value_t zjs_buffer_create(u32_t size, zjs_buffer_t **ret_buf);
 
+/**
+ * Create a new Buffer object viewing part of an existing backing store
+ *
+ * @param store    Backing store, which gains a reference on success
+ * @param offset   Offset of the view within the store in bytes
+ * @param length   Length of the view in bytes
+ * @param ret_buf  Output pointer to receive new buffer handle, or NULL
+ *
+ * @return  New JS Buffer or Error object, and sets *ret_buf to C handle or
+ *            NULL, if given
+ */
+jerry_value_t zjs_buffer_create_view(zjs_buffer_store_t *store, u32_t offset,
+                                     u32_t length, zjs_buffer_t **ret_buf);
+
 #endif  // __zjs_buffer_h__
@@ -0,0 +1,63 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// C includes
+#include <string.h>
+
+// ZJS includes
+#include "zjs_bundle.h"
+
+static const zjs_bundle_header_t *bundle = NULL;
+
+bool zjs_bundle_check(const uint32_t *data, uint32_t length)
+{
+    const zjs_bundle_header_t *header = (const zjs_bundle_header_t *)data;
+    if (length < sizeof(zjs_bundle_header_t) ||
+        header->magic != ZJS_BUNDLE_MAGIC) {
+        return false;
+    }
+    if (header->count > (length - sizeof(zjs_bundle_header_t)) /
+                        sizeof(zjs_bundle_entry_t)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->count; i++) {
+        const zjs_bundle_entry_t *entry = &header->entries[i];
+        if (entry->offset % 8 || entry->size % sizeof(uint32_t) ||
+            entry->offset > length || entry->size > length - entry->offset ||
+            memchr(entry->name, '\0', ZJS_BUNDLE_NAME_LEN) == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const zjs_bundle_entry_t *zjs_bundle_find(const char *name)
+{
+    if (!bundle) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < bundle->count; i++) {
+        if (!strcmp(bundle->entries[i].name, name)) {
+            return &bundle->entries[i];
+        }
+    }
+    return NULL;
+}
+
+jerry_value_t zjs_bundle_run(const zjs_bundle_entry_t *entry)
+{
+    const uint32_t *snapshot =
+        (const uint32_t *)((const uint8_t *)bundle + entry->offset);
+    return jerry_exec_snapshot(snapshot, entry->size, 0,
+                               JERRY_SNAPSHOT_EXEC_ALLOW_STATIC);
+}
+
+jerry_value_t zjs_bundle_run_main(const uint32_t *data)
+{
+    bundle = (const zjs_bundle_header_t *)data;
+    const zjs_bundle_entry_t *entry = zjs_bundle_find(ZJS_BUNDLE_MAIN);
+    if (!entry) {
+        return jerry_create_error(JERRY_ERROR_COMMON,
+                                  (jerry_char_t *)"bundle has no application");
+    }
+    return zjs_bundle_run(entry);
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_bundle_h__
+#define __zjs_bundle_h__
+
+/*
+ * Snapshot bundles
+ *
+ * A bundle holds the snapshot of an application together with snapshots of
+ * the JS modules it requires, built ahead of time by tools/snapshot. The
+ * header is followed by one entry per snapshot, and each snapshot starts on
+ * an 8-byte boundary so it can run in place. The application runs at startup;
+ * modules run the first time require() asks for them, and export themselves
+ * on module.exports as when they were inlined into the application.
+ *
+ * The layout is in the host's byte order, which must match the target's.
+ */
+
+// C includes
+#include <stdbool.h>
+#include <stdint.h>
+
+// JerryScript includes
+#include "jerryscript.h"
+
+#define ZJS_BUNDLE_MAGIC 0x4c444e42  // "BNDL"
+
+// the same as MAX_MODULE_STR_LEN, the longest name require() accepts
+#define ZJS_BUNDLE_NAME_LEN 32
+
+// name of the application's entry
+#define ZJS_BUNDLE_MAIN ""
+
+typedef struct zjs_bundle_entry {
+    char name[ZJS_BUNDLE_NAME_LEN];  // module name as passed to require()
+    uint32_t offset;                 // bytes from the start of the bundle
+    uint32_t size;                   // snapshot size in bytes
+} zjs_bundle_entry_t;
+
+typedef struct zjs_bundle_header {
+    uint32_t magic;
+    uint32_t count;
+    zjs_bundle_entry_t entries[0];
+} zjs_bundle_header_t;
+
+/**
+ * Check whether a snapshot file is a well-formed bundle
+ *
+ * @param data          File contents, word aligned
+ * @param length        File size in bytes
+ *
+ * @return              True if the header and every entry lie within data
+ */
+bool zjs_bundle_check(const uint32_t *data, uint32_t length);
+
+/**
+ * Find a snapshot in the current bundle
+ *
+ * @param name          Module name, or ZJS_BUNDLE_MAIN for the application
+ *
+ * @return              Entry for the snapshot, NULL if there is none
+ */
+const zjs_bundle_entry_t *zjs_bundle_find(const char *name);
+
+/**
+ * Run a snapshot from the current bundle in place
+ *
+ * @param entry         Entry returned by zjs_bundle_find
+ *
+ * @return              Result of the snapshot, an error if it threw
+ */
+jerry_value_t zjs_bundle_run(const zjs_bundle_entry_t *entry);
+
+/**
+ * Make a bundle current and run its application
+ *
+ * @param bundle        Bundle passed to zjs_bundle_check, 8-byte aligned and
+ *                        valid for the life of the program
+ *
+ * @return              Result of the application, an error if it threw or
+ *                        the bundle has no application
+ */
+jerry_value_t zjs_bundle_run_main(const uint32_t *bundle);
+
+#endif  // __zjs_bundle_h__
@@ -11,11 +11,11 @@
 #endif
 
 // C includes
+#include <stdio.h>
 #include <string.h>
 
 #ifndef ZJS_LINUX_BUILD
 // Zephyr includes
-#include <ring_buffer.h>
 #include <zephyr.h>
 
 // ZJS includes
@@ -25,47 +25,116 @@
 #endif
 
 #include "zjs_callbacks.h"
+#include "zjs_loop_stats.h"
+#include "zjs_queue.h"
 #include "zjs_util.h"
 
 // JerryScript includes
 #include "jerryscript.h"
 
+// size of the callback queue in bytes, must be a power of 2; a single
+// callback's args can use at most half of it
 // this could be defined with config options in the future
 #ifndef ZJS_CALLBACK_BUF_SIZE
+#ifdef ZJS_LINUX_BUILD
 #define ZJS_CALLBACK_BUF_SIZE   1024
+#else
+#define ZJS_CALLBACK_BUF_SIZE   512
+#endif
+#endif
+// size of the high priority queue in bytes, must be a power of 2; args too
+// big for it go through the low priority queue instead, unless that would let
+// them overtake older signals for the same callback
+#ifndef ZJS_CALLBACK_HIGH_BUF_SIZE
+#define ZJS_CALLBACK_HIGH_BUF_SIZE  (ZJS_CALLBACK_BUF_SIZE / 2)
+#endif
+// max bytes of signals held on the heap once the queue is full; beyond this
+// signals are dropped
+#ifndef ZJS_CALLBACK_SPILL_MAX
+#ifdef ZJS_LINUX_BUILD
+#define ZJS_CALLBACK_SPILL_MAX  (ZJS_CALLBACK_BUF_SIZE * 8)
+#else
+#define ZJS_CALLBACK_SPILL_MAX  (ZJS_CALLBACK_BUF_SIZE * 4)
 #endif
-// max number of callbacks that can be serviced before continuing execution. If
-// this value is reached, any additional callbacks will be serviced on the next
-// time around the main loop.
-#ifndef ZJS_MAX_CB_LOOP_ITERATION
-#define ZJS_MAX_CB_LOOP_ITERATION   12
 #endif
+// producers registered with zjs_add_backpressure are paused when this many
+// bytes are pending and resumed once it falls back below the low mark
+#define CB_HIGH_WATER  (ZJS_CALLBACK_BUF_SIZE * 3 / 4)
+#define CB_LOW_WATER   (ZJS_CALLBACK_BUF_SIZE / 4)
+#define MAX_BACKPRESSURE  4
 
 #define INITIAL_CALLBACK_SIZE  16
-#define CB_CHUNK_SIZE          16
 #define CB_LIST_MULTIPLIER     4
 
+// IDs hold the slot index in the low bits and the slot's generation above it,
+// so a signal for a callback that has been freed can't reach a new callback
+// that reused the slot
+#define ID_SLOT_BITS   16
+#define ID_SLOT_MASK   ((1 << ID_SLOT_BITS) - 1)
+#define ID_GEN_MASK    0x7fff
+#define MAKE_ID(s, g)  ((zjs_callback_id)(((g) & ID_GEN_MASK) << ID_SLOT_BITS | (s)))
+#define ID_SLOT(id)    ((u32_t)(id) & ID_SLOT_MASK)
+#define ID_GEN(id)     (((u32_t)(id) >> ID_SLOT_BITS) & ID_GEN_MASK)
+// end of the free list; also caps the map at 65535 slots
+#define NO_SLOT        ID_SLOT_MASK
+
 // flag bit value for JS callback
 #define CALLBACK_TYPE_JS    0
 // flag bit value for C callback
 #define CALLBACK_TYPE_C     1
 
-// Bits in flags for once, type (C or JS), and JS type (single or list)
+// Bits in flags for once, type (C or JS), removed, high priority, and freeing
+// once the callback's queued records have been serviced
 #define ONCE_BIT       0
 #define TYPE_BIT       1
 #define CB_REMOVED_BIT 2
+#define HIGH_PRIO_BIT  3
+#define FREE_LATER_BIT 4
 // Macros to set the bits in flags
 #define SET_ONCE(f, b)     f |= (b << ONCE_BIT)
 #define SET_TYPE(f, b)     f |= (b << TYPE_BIT)
 #define SET_CB_REMOVED(f)  f |= (1 << CB_REMOVED_BIT)
+#define SET_FREE_LATER(f)  f |= (1 << FREE_LATER_BIT)
+#define SET_HIGH_PRIO(f, b) \
+    f = (f & ~(1 << HIGH_PRIO_BIT)) | ((b) << HIGH_PRIO_BIT)
 // Macros to get the bits in flags
 #define GET_ONCE(f)        (f & (1 << ONCE_BIT)) >> ONCE_BIT
 #define GET_TYPE(f)        (f & (1 << TYPE_BIT)) >> TYPE_BIT
 #define GET_CB_REMOVED(f)  (f & (1 << CB_REMOVED_BIT)) >> CB_REMOVED_BIT
+#define GET_HIGH_PRIO(f)   (f & (1 << HIGH_PRIO_BIT)) >> HIGH_PRIO_BIT
+#define GET_FREE_LATER(f)  (f & (1 << FREE_LATER_BIT)) >> FREE_LATER_BIT
 
-// ring buffer values for flushing pending callbacks
+// queue record values for flushing pending callbacks
 #define CB_FLUSH_ONE 0xfe
 #define CB_FLUSH_ALL 0xff
+// queue record value for delivering the latest args of a coalescing callback
+#define CB_COALESCED 0xfd
+
+#ifdef ZJS_LOOP_STATS
+// every queued or spilled record starts with the cycle count when it was
+// signaled, to measure how long it waited
+#define STAMP_SIZE32  1
+// number of live callbacks and creating modules tracked for latency
+#ifdef ZJS_LINUX_BUILD
+#define LATENCY_CALLBACKS  32
+#define LATENCY_MODULES    16
+#else
+#define LATENCY_CALLBACKS  4
+#define LATENCY_MODULES    8
+#endif
+#else
+#define STAMP_SIZE32  0
+#endif
+
+// latest args of a coalescing callback, replaced in place until serviced
+typedef struct coalesce_slot {
+    u32_t max_size;   // capacity of args in bytes
+    u32_t size;       // size of the pending args in bytes
+    u32_t dropped;    // signals replaced since the last delivery
+    u32_t delivered;  // dropped count for the delivery in progress
+    bool pending;     // a CB_COALESCED record is queued
+    u32_t args[0];
+} coalesce_slot_t;
 
 #define MAX_CALLER_CREATOR_LEN 128
 typedef struct zjs_callback {
@@ -76,6 +145,15 @@ typedef struct zjs_callback {
         jerry_value_t js_func;         // Single JS function callback
         zjs_c_callback_func function;  // C callback
     };
+    coalesce_slot_t *coalesce;  // set if signals should be coalesced
+    // signal records waiting in the high queue, and in the low queue or the
+    //   spill list; a callback only uses one side at a time so the different
+    //   drain orders can't reorder its signals
+    zjs_port_atomic_t high_pending;
+    zjs_port_atomic_t low_pending;
+#ifdef ZJS_LOOP_STATS
+    const char *origin;         // source file that created this callback
+#endif
     zjs_callback_id id;
     u8_t flags;  // holds once and type bits
     u8_t max_funcs;
@@ -86,40 +164,28 @@ typedef struct zjs_callback {
 #endif
 } zjs_callback_t;
 
-#ifdef ZJS_LINUX_BUILD
-static u8_t args_buffer[ZJS_CALLBACK_BUF_SIZE];
-static struct zjs_port_ring_buf ring_buffer;
-#else
-SYS_RING_BUF_DECLARE_POW2(ring_buffer, 6);
-#endif
-static u8_t ring_buf_initialized = 1;
+// lock-free queues of signaled callbacks, filled by any thread or ISR and
+// drained by the main loop; the high priority queue carries signals from ISRs
+// and high priority callbacks and is always drained first
+static u32_t queue_buffer[ZJS_CALLBACK_BUF_SIZE / sizeof(u32_t)];
+static u32_t high_queue_buffer[ZJS_CALLBACK_HIGH_BUF_SIZE / sizeof(u32_t)];
+static zjs_queue_t cb_queue;
+static zjs_queue_t cb_high_queue;
+static u8_t cb_queue_initialized = 0;
+static u32_t cb_budget_us = ZJS_CALLBACK_BUDGET_US;
 
 #ifdef ZJS_LINUX_BUILD
 #define k_is_preempt_thread() 0
-#define RB_LOCK() do {} while (0)
-#define RB_UNLOCK() do {} while (0)
+#define k_is_in_isr() 0
 #define CB_LOCK() do {} while (0)
 #define CB_UNLOCK() do {} while (0)
+#define IRQ_LOCK() do {} while (0)
+#define IRQ_UNLOCK() do {} while (0)
 #else  // !ZJS_LINUX_BUILD
-// mutex to ensure only one thread can access ring buffer at a time
-static struct k_mutex ring_mutex;
-
-#define RB_LOCK()                                \
-{                                                \
-    LPRINT("Ringbuf lock...");                   \
-    if (k_mutex_lock(&ring_mutex, K_FOREVER)) {  \
-        ERR_PRINT("Ringbuf lock error.\n");      \
-    } else {                                     \
-        LPRINT("Ringbuf locked.");               \
-    }                                            \
-}
-
-#define RB_UNLOCK()               \
-{                                 \
-    LPRINT("Ringbuf unlock...");  \
-    k_mutex_unlock(&ring_mutex);  \
-    LPRINT("Ringbuf unlocked.");  \
-}
+// spill list links and coalesced args are only touched briefly, so just keep
+// ISRs and other threads out
+#define IRQ_LOCK()    int irq_key = irq_lock()
+#define IRQ_UNLOCK()  irq_unlock(irq_key)
 
 // mutex to ensure only one thread can access cb_map at a time
 static struct k_mutex cb_mutex;
@@ -142,15 +208,105 @@ static struct k_mutex cb_mutex;
 }
 #endif  // ZJS_LINUX_BUILD
 
-static zjs_callback_id cb_limit = INITIAL_CALLBACK_SIZE;
-static zjs_callback_id cb_size = 0;
-static zjs_callback_t **cb_map = NULL;
+// slot in the callback map; free slots are linked through next_free
+typedef struct cb_slot {
+    zjs_callback_t *cb;
+    u16_t gen;        // bumped every time the slot is freed
+    u16_t next_free;  // next free slot, while this one is free
+} cb_slot_t;
+
+static u32_t cb_size = 0;  // number of slots in cb_map
+static u32_t cb_free = NO_SLOT;
+static cb_slot_t *cb_map = NULL;
 
 static zjs_callback_id defer_id = -1;
+static zjs_callback_id defer_io_id = -1;
+
+static int zjs_queue_error_count = 0;
+static int zjs_queue_error_max = 0;
+static int zjs_queue_last_error = 0;
+
+// signals that didn't fit in the queue, allocated from thread context only
+// and serviced in order once the queue has been drained
+typedef struct spill_entry {
+    struct spill_entry *next;
+    zjs_callback_id id;
+    u8_t value;     // record value, as in the queue
+    u32_t size;     // size of data in 32-bit words
+    u32_t data[0];
+} spill_entry_t;
+
+static spill_entry_t *spill_head = NULL;
+static spill_entry_t *spill_tail = NULL;
+static u32_t spill_bytes = 0;
+
+typedef struct backpressure {
+    zjs_backpressure_func func;
+    void *handle;
+} backpressure_t;
+
+static backpressure_t bp_list[MAX_BACKPRESSURE];
+static zjs_port_atomic_t bp_paused = 0;
+
+static zjs_callback_stats_t cb_stats;
+
+#ifdef ZJS_LOOP_STATS
+// module totals first, then individual callbacks; only the main thread
+//   touches these
+static zjs_callback_latency_t latency[LATENCY_MODULES + LATENCY_CALLBACKS];
+
+static zjs_callback_latency_t *find_latency(zjs_callback_id id,
+                                            const char *module, bool add)
+{
+    // effects: returns the entry for a callback ID, or for a module if id is
+    //            -1, adding it if there is room and add is set
+    u32_t start = (id < 0) ? 0 : LATENCY_MODULES;
+    u32_t end = (id < 0) ? LATENCY_MODULES : LATENCY_MODULES +
+                                             LATENCY_CALLBACKS;
+    zjs_callback_latency_t *empty = NULL;
+    for (u32_t i = start; i < end; i++) {
+        if (!latency[i].module) {
+            if (!empty) {
+                empty = &latency[i];
+            }
+        } else if (latency[i].id == id &&
+                   (id >= 0 || latency[i].module == module)) {
+            return &latency[i];
+        }
+    }
+    if (!add || !empty) {
+        return NULL;
+    }
+    memset(empty, 0, sizeof(zjs_callback_latency_t));
+    empty->id = id;
+    empty->module = module;
+    return empty;
+}
+
+static void add_sample(u16_t *hist, u32_t *max, u64_t *sum, u32_t us)
+{
+    int bucket = zjs_log2_bucket(us, ZJS_LATENCY_BUCKETS);
+    if (hist[bucket] < 0xffff) {
+        hist[bucket]++;
+    }
+    if (us > *max) {
+        *max = us;
+    }
+    *sum += us;
+}
 
-static int zjs_ringbuf_error_count = 0;
-static int zjs_ringbuf_error_max = 0;
-static int zjs_ringbuf_last_error = 0;
+static void record_latency(zjs_callback_latency_t *entry, u32_t wait_us,
+                           u32_t run_us)
+{
+    if (entry) {
+        entry->count++;
+        add_sample(entry->wait_hist, &entry->wait_max_us,
+                   &entry->wait_sum_us, wait_us);
+        add_sample(entry->run_hist, &entry->run_max_us, &entry->run_sum_us,
+                   run_us);
+    }
+}
+#endif
 
 #ifdef INSTRUMENT_CALLBACKS
 static void set_info_string(char *str, const char *file, const char *func)
@@ -167,38 +323,248 @@ static void set_info_string(char *str, const char *file, const char *func)
 }
 #endif
 
-static zjs_callback_id new_id(void)
+static u32_t pending_bytes(void)
 {
-    zjs_callback_id id = 0;
-    // NOTE: We could wait until after we check for a NULL callback slot in
-    //   the map before we increase allocation; or else store a count that
-    //   can be less than cb_size when callbacks are removed.
-    CB_LOCK();
-    if (cb_size >= cb_limit) {
-        cb_limit += CB_CHUNK_SIZE;
-        size_t size = sizeof(zjs_callback_t *) * cb_limit;
-        zjs_callback_t **new_map = zjs_malloc(size);
-        if (!new_map) {
-            DBG_PRINT("error allocating space for new callback map\n");
-            return -1;
-        }
-        DBG_PRINT("callback list size too small, increasing by %d\n",
-                  CB_CHUNK_SIZE);
-        memset(new_map, 0, size);
-        memcpy(new_map, cb_map, sizeof(zjs_callback_t *) * cb_size);
+    return (zjs_queue_used(&cb_queue) + zjs_queue_used(&cb_high_queue)) *
+           sizeof(u32_t) + spill_bytes;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static void set_backpressure(bool pause)
+{
+    // effects: tells every registered producer to pause or resume, only on
+    //            the transition between the two states
+    if (!zjs_port_atomic_cas(&bp_paused, pause ? 0 : 1, pause ? 1 : 0)) {
+        return;
+    }
+    if (pause) {
+        cb_stats.pauses++;
+    }
+    for (int i = 0; i < MAX_BACKPRESSURE; i++) {
+        if (bp_list[i].func) {
+            bp_list[i].func(bp_list[i].handle, pause);
+        }
+    }
+}
+
+static u32_t spill_entry_bytes(u32_t size32)
+{
+    return sizeof(spill_entry_t) + size32 * sizeof(u32_t);
+}
+
+static int spill_callback(zjs_callback_id id, u8_t value, const void *args,
+                          u32_t size, u32_t stamp)
+{
+    // requires: not called from an ISR
+    //  effects: appends a heap copy of the args to the spill list, laid out
+    //             like a queue record
+    u32_t size32 = (size + 3) / 4 + STAMP_SIZE32;
+    u32_t bytes = spill_entry_bytes(size32);
+    if (spill_bytes + bytes > ZJS_CALLBACK_SPILL_MAX) {
+        return -ENOSPC;
+    }
+    spill_entry_t *entry = zjs_malloc(bytes);
+    if (!entry) {
+        return -ENOMEM;
+    }
+    entry->next = NULL;
+    entry->id = id;
+    entry->value = value;
+    entry->size = size32;
+    if (size32) {
+        entry->data[size32 - 1] = 0;
+#ifdef ZJS_LOOP_STATS
+        entry->data[0] = stamp;
+#endif
+        memcpy(entry->data + STAMP_SIZE32, args, size);
+    }
+
+    IRQ_LOCK();
+    if (spill_tail) {
+        spill_tail->next = entry;
+    } else {
+        spill_head = entry;
+    }
+    spill_tail = entry;
+    spill_bytes += bytes;
+    IRQ_UNLOCK();
+    cb_stats.spilled++;
+    return 0;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static int put_record(zjs_queue_t *queue, zjs_callback_id id, u8_t value,
+                      const void *args, u32_t size, u32_t stamp)
+{
+#ifdef ZJS_LOOP_STATS
+    u32_t size32 = (size + 3) / 4 + STAMP_SIZE32;
+    if (ZJS_QUEUE_HEADER_SIZE32 + size32 > queue->size / 2) {
+        return -EMSGSIZE;
+    }
+    u32_t *data = zjs_queue_reserve(queue, id, value, size32);
+    if (!data) {
+        return -ENOSPC;
+    }
+    data[0] = stamp;
+    if (size) {
+        memcpy(data + STAMP_SIZE32, args, size);
+    }
+    zjs_queue_commit(queue, data);
+    return 0;
+#else
+    return zjs_queue_put(queue, id, value, args, size);
+#endif
+}
+
+static spill_entry_t *unspill_callback(void)
+{
+    IRQ_LOCK();
+    spill_entry_t *entry = spill_head;
+    if (entry) {
+        spill_head = entry->next;
+        if (!spill_head) {
+            spill_tail = NULL;
+        }
+        spill_bytes -= spill_entry_bytes(entry->size);
+    }
+    IRQ_UNLOCK();
+    return entry;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static int put_counted(zjs_queue_t *queue, zjs_port_atomic_t *pending,
+                       zjs_callback_id id, u8_t value, const void *args,
+                       u32_t size, u32_t stamp)
+{
+    // effects: puts a signal record, counting it as pending before it can be
+    //            serviced
+    zjs_port_atomic_inc(pending);
+    int ret = put_record(queue, id, value, args, size, stamp);
+    if (ret) {
+        zjs_port_atomic_dec(pending);
+    }
+    return ret;
+}
+
+static int spill_counted(zjs_callback_t *cb, u8_t value, const void *args,
+                         u32_t size, u32_t stamp)
+{
+    // requires: not called from an ISR
+    zjs_port_atomic_inc(&cb->low_pending);
+    int ret = spill_callback(cb->id, value, args, size, stamp);
+    if (ret) {
+        zjs_port_atomic_dec(&cb->low_pending);
+    }
+    return ret;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static int coalesce_args(zjs_callback_t *cb, const void *args, u32_t size)
+{
+    // effects: stores args as the latest for a coalescing callback; returns 1
+    //            if a delivery was already queued and the args replaced older
+    //            ones, 0 if the caller must queue one, or -EMSGSIZE
+    coalesce_slot_t *slot = cb->coalesce;
+    if (size > slot->max_size) {
+        return -EMSGSIZE;
+    }
+
+    u32_t old[slot->max_size / sizeof(u32_t) + 1];
+    u32_t old_size = 0;
+    IRQ_LOCK();
+    bool was_pending = slot->pending;
+    if (was_pending) {
+        old_size = slot->size;
+        memcpy(old, slot->args, old_size);
+        slot->dropped++;
+    }
+    memcpy(slot->args, args, size);
+    slot->size = size;
+    slot->pending = true;
+    IRQ_UNLOCK();
+
+    if (was_pending && GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+        // JS callbacks are only signaled from the main thread
+        int argc = old_size / sizeof(jerry_value_t);
+        for (int i = 0; i < argc; i++) {
+            jerry_release_value((jerry_value_t)old[i]);
+        }
+    }
+    return was_pending ? 1 : 0;
+}
+
+static zjs_callback_t *get_cb(zjs_callback_id id)
+{
+    // effects: returns the callback for id, or NULL if id is invalid or
+    //            refers to a callback that has been freed
+    if (id < 0) {
+        return NULL;
+    }
+    u32_t slot = ID_SLOT(id);
+    if (slot >= cb_size || cb_map[slot].gen != ID_GEN(id)) {
+        return NULL;
+    }
+    return cb_map[slot].cb;
+}
+
+static bool grow_map(void)
+{
+    // effects: doubles the callback map and links the new slots into the free
+    //            list; returns false if out of memory or slots
+    u32_t new_size = cb_size ? cb_size * 2 : INITIAL_CALLBACK_SIZE;
+    if (new_size > NO_SLOT) {
+        new_size = NO_SLOT;
+    }
+    if (new_size <= cb_size) {
+        DBG_PRINT("callback map is full\n");
+        return false;
+    }
+    cb_slot_t *new_map = zjs_malloc(sizeof(cb_slot_t) * new_size);
+    if (!new_map) {
+        DBG_PRINT("error allocating space for new callback map\n");
+        return false;
+    }
+    DBG_PRINT("callback map too small, increasing to %u\n", new_size);
+    if (cb_map) {
+        memcpy(new_map, cb_map, sizeof(cb_slot_t) * cb_size);
         zjs_free(cb_map);
-        cb_map = new_map;
     }
-    while (cb_map[id] != NULL) {
-        id++;
+    // link the new slots in ascending order so low IDs get used first
+    for (u32_t i = cb_size; i < new_size; i++) {
+        new_map[i].cb = NULL;
+        new_map[i].gen = 0;
+        new_map[i].next_free = (i + 1 < new_size) ? i + 1 : cb_free;
     }
-    if (id >= cb_size) {
-        cb_size = id + 1;
+    cb_free = cb_size;
+    cb_map = new_map;
+    cb_size = new_size;
+    return true;
+}
+
+static zjs_callback_id new_id(zjs_callback_t *cb)
+{
+    // effects: claims a free slot for cb and returns its ID, or -1
+    zjs_callback_id id = -1;
+    CB_LOCK();
+    if (cb_free != NO_SLOT || grow_map()) {
+        u32_t slot = cb_free;
+        cb_free = cb_map[slot].next_free;
+        cb_map[slot].cb = cb;
+        id = MAKE_ID(slot, cb_map[slot].gen);
     }
     CB_UNLOCK();
     return id;
 }
 
+static void free_slot(u32_t slot)
+{
+    // effects: returns slot to the free list, invalidating its current ID
+    cb_map[slot].cb = NULL;
+    cb_map[slot].gen = (cb_map[slot].gen + 1) & ID_GEN_MASK;
+    cb_map[slot].next_free = cb_free;
+    cb_free = slot;
+}
+
 typedef struct deferred_work {
     zjs_deferred_work callback;
     u32_t length;  // length of user data
@@ -229,26 +595,22 @@ static void deferred_work_callback(void *handle, const void *args)
 void zjs_init_callbacks(void)
 {
 #ifndef ZJS_LINUX_BUILD
-    k_mutex_init(&ring_mutex);
     k_mutex_init(&cb_mutex);
 #endif
 
-    if (!cb_map) {
-        size_t size = sizeof(zjs_callback_t *) * INITIAL_CALLBACK_SIZE;
-        cb_map = (zjs_callback_t **)zjs_malloc(size);
-        if (!cb_map) {
-            DBG_PRINT("error allocating space for CB map\n");
-            return;
-        }
-        memset(cb_map, 0, size);
+    if (!cb_map && !grow_map()) {
+        return;
+    }
+    if (!cb_queue_initialized) {
+        zjs_queue_init(&cb_queue, queue_buffer, SIZE32_OF(queue_buffer));
+        zjs_queue_init(&cb_high_queue, high_queue_buffer,
+                       SIZE32_OF(high_queue_buffer));
+        cb_queue_initialized = 1;
     }
-#ifdef ZJS_LINUX_BUILD
-    zjs_port_ring_buf_init(&ring_buffer, ZJS_CALLBACK_BUF_SIZE,
-                           (u32_t *)args_buffer);
-#endif
-    ring_buf_initialized = 1;
 
     defer_id = zjs_add_c_callback(NULL, deferred_work_callback);
+    defer_io_id = zjs_add_c_callback(NULL, deferred_work_callback);
+    zjs_set_callback_priority(defer_io_id, ZJS_CALLBACK_PRIORITY_HIGH);
     return;
 }
 
@@ -257,9 +619,10 @@ bool zjs_edit_js_func(zjs_callback_id id, jerry_value_t func)
     // requires: only run from main thread
     CB_LOCK();
     bool rval = false;
-    if (id >= 0 && cb_map[id]) {
-        jerry_release_value(cb_map[id]->js_func);
-        cb_map[id]->js_func = jerry_acquire_value(func);
+    zjs_callback_t *cb = get_cb(id);
+    if (cb) {
+        jerry_release_value(cb->js_func);
+        cb->js_func = jerry_acquire_value(func);
         rval = true;
     }
     CB_UNLOCK();
@@ -270,10 +633,10 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
                                   jerry_value_t this,
                                   void *handle,
                                   zjs_post_callback_func post,
-                                  u8_t once
+                                  u8_t once,
+                                  const char *file
 #ifdef INSTRUMENT_CALLBACKS
                                   ,
-                                  const char *file,
                                   const char *func)
 #else
                                   )
@@ -288,65 +651,128 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
 
     SET_ONCE(new_cb->flags, (once) ? 1 : 0);
     SET_TYPE(new_cb->flags, CALLBACK_TYPE_JS);
-    new_cb->id = new_id();
     new_cb->js_func = jerry_acquire_value(js_func);
     new_cb->this = jerry_acquire_value(this);
     new_cb->post = post;
     new_cb->handle = handle;
     new_cb->max_funcs = 1;
     new_cb->num_funcs = 1;
+#ifdef ZJS_LOOP_STATS
+    new_cb->origin = file;
+#endif
+#ifdef INSTRUMENT_CALLBACKS
+    set_info_string(new_cb->creator, file, func);
+#endif
 
-    CB_LOCK();
     // Add callback to list
-    cb_map[new_cb->id] = new_cb;
+    new_cb->id = new_id(new_cb);
+    if (new_cb->id < 0) {
+        jerry_release_value(new_cb->js_func);
+        jerry_release_value(new_cb->this);
+        zjs_free(new_cb);
+        return -1;
+    }
 
     DBG_PRINT("adding new callback id %d, js_func=%p, once=%u\n", new_cb->id,
               (void *)(uintptr_t)new_cb->js_func, once);
-
-#ifdef INSTRUMENT_CALLBACKS
-    set_info_string(cb_map[new_cb->id]->creator, file, func);
-#endif
-    CB_UNLOCK();
     return new_cb->id;
 }
 
 static void zjs_free_callback(zjs_callback_id id)
 {
-    // effects: frees callback associated with id if it's marked as removed
+    // effects: frees callback associated with id if it's marked as removed;
+    //            if records for it are still queued or spilled, frees it once
+    //            they have been serviced instead
     CB_LOCK();
-    if (id >= 0 && cb_map[id] && GET_CB_REMOVED(cb_map[id]->flags)) {
-        zjs_free(cb_map[id]);
-        cb_map[id] = NULL;
+    zjs_callback_t *cb = get_cb(id);
+    if (cb && GET_CB_REMOVED(cb->flags)) {
+        if (zjs_port_atomic_get(&cb->high_pending) ||
+            zjs_port_atomic_get(&cb->low_pending)) {
+            // the JS args in those records are only released while the
+            //   callback still exists
+            SET_FREE_LATER(cb->flags);
+            CB_UNLOCK();
+            return;
+        }
+        coalesce_slot_t *slot = cb->coalesce;
+        if (slot) {
+            if (slot->pending && GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+                int argc = slot->size / sizeof(jerry_value_t);
+                for (int i = 0; i < argc; i++) {
+                    jerry_release_value((jerry_value_t)slot->args[i]);
+                }
+            }
+            zjs_free(slot);
+        }
+#ifdef ZJS_LOOP_STATS
+        // the module total keeps the history
+        zjs_callback_latency_t *entry = find_latency(id, NULL, false);
+        if (entry) {
+            entry->module = NULL;
+        }
+#endif
+        zjs_free(cb);
+        free_slot(ID_SLOT(id));
     }
     CB_UNLOCK();
 }
 
+static void uncount_record(u32_t id, u8_t value, bool high)
+{
+    // effects: stops counting a serviced signal record as pending, and frees
+    //            its callback if that was only waiting for its records
+    if (value == CB_FLUSH_ONE || value == CB_FLUSH_ALL) {
+        return;
+    }
+    zjs_callback_t *cb = get_cb(id);
+    if (cb) {
+        zjs_port_atomic_dec(high ? &cb->high_pending : &cb->low_pending);
+        if (GET_FREE_LATER(cb->flags)) {
+            zjs_free_callback(id);
+        }
+    }
+}
+
+static int queue_flush(zjs_callback_id id, u8_t value)
+{
+    // requires: not called from an ISR
+    //  effects: queues a flush record behind every signal already queued or
+    //             spilled, so the callback outlives the records for it
+    int ret = -ENOSPC;
+    if (!spill_head) {
+        ret = put_record(&cb_queue, id, value, NULL, 0, 0);
+    }
+    if (ret) {
+        ret = spill_callback(id, value, NULL, 0, 0);
+    }
+    return ret;
+}
+
 static void zjs_remove_callback_priv(zjs_callback_id id, bool skip_flush)
 {
     // effects: removes the callback associated with id; if skip_flush is true,
     //            assumes the callback will be "flushed" elsewhere, that is
     //            freed and the id reclaimed; otherwise, tries to do it here
     CB_LOCK();
-    if (id >= 0 && cb_map[id]) {
+    zjs_callback_t *cb = get_cb(id);
+    if (cb) {
         // Don't free a callback after its been freed
-        if (GET_CB_REMOVED(cb_map[id]->flags)) {
+        if (GET_CB_REMOVED(cb->flags)) {
             CB_UNLOCK();
             return;
         }
 
-        if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
-            jerry_release_value(cb_map[id]->js_func);
-            jerry_release_value(cb_map[id]->this);
+        if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+            jerry_release_value(cb->js_func);
+            jerry_release_value(cb->this);
         }
-        SET_CB_REMOVED(cb_map[id]->flags);
+        SET_CB_REMOVED(cb->flags);
         CB_UNLOCK();
         if (!skip_flush) {
-            RB_LOCK();
-            int ret = zjs_port_ring_buf_put(&ring_buffer, (u16_t)id,
-                                            CB_FLUSH_ONE, NULL, 0);
-            RB_UNLOCK();
+            int ret = queue_flush(id, CB_FLUSH_ONE);
             if (ret) {
-                // couldn't add flush command, so just free now
+                // couldn't add flush command, so free now or once its
+                //   queued records have been serviced
                 DBG_PRINT("no room for flush callback %d command\n", id);
                 zjs_free_callback(id);
             }
@@ -365,14 +791,12 @@ void zjs_remove_callback(zjs_callback_id id)
 void zjs_remove_all_callbacks()
 {
     // try posting a command to flush all removed callbacks
-    RB_LOCK();
-    int ret = zjs_port_ring_buf_put(&ring_buffer, 0, CB_FLUSH_ALL, NULL, 0);
-    RB_UNLOCK();
+    int ret = queue_flush(0, CB_FLUSH_ALL);
     bool skip_flush = ret ? false : true;
-    for (int i = 0; i < cb_size; i++) {
+    for (u32_t i = 0; i < cb_size; i++) {
         CB_LOCK();
-        if (cb_map[i]) {
-            zjs_remove_callback_priv(i, skip_flush);
+        if (cb_map[i].cb) {
+            zjs_remove_callback_priv(cb_map[i].cb->id, skip_flush);
         }
         CB_UNLOCK();
     }
@@ -391,25 +815,23 @@ void signal_callback_priv(zjs_callback_id id,
 #endif
 {
 #ifdef DEBUG_CALLBACKS
-    DBG_PRINT("pushing item to ring buffer. id=%d, args=%p, size=%u\n", id,
-              args, size);
+    DBG_PRINT("pushing item to callback queue. id=%d, args=%p, size=%u\n",
+              id, args, size);
 #endif
     int in_thread = k_is_preempt_thread();  // versus ISR or co-op thread
-#ifndef ZJS_LINUX_BUILD
-    int key = 0;
-#endif
     if (in_thread) CB_LOCK();
-    if (id < 0 || id >= cb_size || !cb_map[id]) {
+    zjs_callback_t *cb = get_cb(id);
+    if (!cb) {
         DBG_PRINT("callback ID %d does not exist\n", id);
         if (in_thread) CB_UNLOCK();
         return;
     }
-    if (GET_CB_REMOVED(cb_map[id]->flags)) {
+    if (GET_CB_REMOVED(cb->flags)) {
         DBG_PRINT("callback already removed\n");
         if (in_thread) CB_UNLOCK();
         return;
     }
-    if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
+    if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
         // for JS, acquire values and release them after servicing callback
         int argc = size / sizeof(jerry_value_t);
         jerry_value_t *values = (jerry_value_t *)args;
@@ -418,33 +840,82 @@ void signal_callback_priv(zjs_callback_id id,
         }
     }
 #ifdef INSTRUMENT_CALLBACKS
-    set_info_string(cb_map[id]->caller, file, func);
+    set_info_string(cb->caller, file, func);
 #endif
-#ifndef ZJS_LINUX_BUILD
-    if (in_thread) {
-        RB_LOCK();
-        key = irq_lock();
-    }
-#endif
-    int ret = zjs_port_ring_buf_put(&ring_buffer,
-                                    (u16_t)id,
-                                    0,  // we use value for CB_FLUSH_ONE/ALL
-                                    (u32_t *)args,
-                                    (u8_t)((size + 3) / 4));
-    // Need to unlock here or callback may be blocked when it gets called.
-    // NOTE: this is a temporary fix, we should implement a lock ID system
-    // rather than locking everything, as we are only trying to prevent a
-    // callback
-    // from being edited and called at the same time.
-#ifndef ZJS_LINUX_BUILD
-    if (in_thread) {
-        irq_unlock(key);
-        RB_UNLOCK();
+    int ret = 0;
+    u8_t value = 0;
+    const void *qargs = args;
+    u32_t qsize = size;
+    coalesce_slot_t *slot = cb->coalesce;
+    if (slot) {
+        ret = coalesce_args(cb, args, size);
+        if (ret > 0) {
+            // the record already queued will deliver the new args
+            if (in_thread) CB_UNLOCK();
+            return;
+        }
+        // queue an empty record that picks up the latest args when serviced
+        value = CB_COALESCED;
+        qargs = NULL;
+        qsize = 0;
     }
-    zjs_loop_unblock();
+
+    // the queue is lock-free, so ISRs and threads can race to put records;
+    //   the value field is reserved for CB_FLUSH_ONE/ALL and CB_COALESCED
+    bool can_spill = !k_is_in_isr();
+#ifdef ZJS_LOOP_STATS
+    u32_t stamp = zjs_port_get_cycles();
+#else
+    u32_t stamp = 0;
 #endif
+    if (ret == 0) {
+        // the high queue is drained first, but low records still get a turn
+        //   once the budget runs out, so a callback stays on the side where
+        //   its older signals are until they have all been serviced
+        bool has_high = zjs_port_atomic_get(&cb->high_pending) != 0;
+        bool has_low = zjs_port_atomic_get(&cb->low_pending) != 0;
+        ret = -ENOSPC;
+        if (has_high ||
+            (!has_low && (!can_spill || GET_HIGH_PRIO(cb->flags)))) {
+            ret = put_counted(&cb_high_queue, &cb->high_pending, id, value,
+                              qargs, qsize, stamp);
+        }
+        // if it still has signals in the high queue, the only way to keep
+        //   them in order is to drop this one
+        if (ret != 0 && !has_high) {
+            if (spill_head && can_spill) {
+                // stay behind the signals that have already spilled
+                ret = spill_counted(cb, value, qargs, qsize, stamp);
+            } else {
+                ret = put_counted(&cb_queue, &cb->low_pending, id, value,
+                                  qargs, qsize, stamp);
+                if (ret != 0 && can_spill) {
+                    ret = spill_counted(cb, value, qargs, qsize, stamp);
+                }
+            }
+        }
+        if (slot && ret != 0) {
+            // nothing is queued to deliver the args, so let the next signal
+            //   try again
+            IRQ_LOCK();
+            slot->pending = false;
+            slot->size = 0;
+            IRQ_UNLOCK();
+        }
+    }
+    zjs_loop_unblock();
+
+    u32_t pending = pending_bytes();
+    if (pending > cb_stats.high_water) {
+        cb_stats.high_water = pending;
+    }
+    // an oversized record or a failed coalesced signal says nothing about
+    //   how full the queues are, so only pause for real lack of room
+    if (ret == -ENOSPC || pending >= CB_HIGH_WATER) {
+        set_backpressure(true);
+    }
     if (ret != 0) {
-        if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
+        if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
             // for JS, acquire values and release them after servicing callback
             int argc = size / sizeof(jerry_value_t);
             jerry_value_t *values = (jerry_value_t *)args;
@@ -453,13 +924,16 @@ void signal_callback_priv(zjs_callback_id id,
             }
         }
 
-        zjs_ringbuf_error_count++;
-        zjs_ringbuf_last_error = ret;
+        cb_stats.dropped++;
+        zjs_queue_error_count++;
+        zjs_queue_last_error = ret;
     }
     if (in_thread) CB_UNLOCK();
 }
 
-zjs_callback_id zjs_add_c_callback(void *handle, zjs_c_callback_func callback)
+zjs_callback_id add_c_callback_priv(void *handle,
+                                    zjs_c_callback_func callback,
+                                    const char *file)
 {
     zjs_callback_t *new_cb = zjs_malloc(sizeof(zjs_callback_t));
     if (!new_cb) {
@@ -470,32 +944,36 @@ zjs_callback_id zjs_add_c_callback(void *handle, zjs_c_callback_func callback)
 
     SET_ONCE(new_cb->flags, 0);
     SET_TYPE(new_cb->flags, CALLBACK_TYPE_C);
-    CB_LOCK();
-    new_cb->id = new_id();
     new_cb->function = callback;
     new_cb->handle = handle;
+#ifdef ZJS_LOOP_STATS
+    new_cb->origin = file;
+#endif
 
     // Add callback to list
-    cb_map[new_cb->id] = new_cb;
+    new_cb->id = new_id(new_cb);
+    if (new_cb->id < 0) {
+        zjs_free(new_cb);
+        return -1;
+    }
 
     DBG_PRINT("adding new C callback id %d\n", new_cb->id);
-    CB_UNLOCK();
     return new_cb->id;
 }
 
 #ifdef DEBUG_BUILD
 void print_callbacks(void)
 {
-    int i;
-    for (i = 0; i < cb_size; i++) {
-        if (cb_map[i]) {
-            if (GET_TYPE(cb_map[i]->flags) == CALLBACK_TYPE_JS) {
+    for (u32_t i = 0; i < cb_size; i++) {
+        zjs_callback_t *cb = cb_map[i].cb;
+        if (cb) {
+            if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
                 ZJS_PRINT("[%u] JS Callback:\n\tType: ", i);
-                if (jerry_value_is_function(cb_map[i]->js_func)) {
+                if (jerry_value_is_function(cb->js_func)) {
                     ZJS_PRINT("Single Function\n");
                     ZJS_PRINT("\tjs_func: %p\n",
-                              (void *)(uintptr_t)cb_map[i]->js_func);
-                    ZJS_PRINT("\tonce: %u\n", GET_ONCE(cb_map[i]->flags));
+                              (void *)(uintptr_t)cb->js_func);
+                    ZJS_PRINT("\tonce: %u\n", GET_ONCE(cb->flags));
                 } else {
                     ZJS_PRINT("js_func is not a function\n");
                 }
@@ -512,142 +990,232 @@ void print_callbacks(void)
 void zjs_call_callback(zjs_callback_id id, const void *data, u32_t sz)
 {
     CB_LOCK();
-    if (id == -1 || id >= cb_size || !cb_map[id]) {
+    zjs_callback_t *cb = get_cb(id);
+    if (!cb) {
         ERR_PRINT("callback %d does not exist\n", id);
-    } else if (GET_CB_REMOVED(cb_map[id]->flags)) {
+    } else if (GET_CB_REMOVED(cb->flags)) {
         DBG_PRINT("callback %d has already been removed\n", id);
     } else {
-        if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
+        if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
             jerry_value_t *values = (jerry_value_t *)data;
             ZVAL_MUTABLE rval;
-            if (!jerry_value_is_undefined(cb_map[id]->js_func)) {
-                rval = jerry_call_function(cb_map[id]->js_func,
-                                           cb_map[id]->this, values, sz);
+            if (!jerry_value_is_undefined(cb->js_func)) {
+                rval = jerry_call_function(cb->js_func,
+                                           cb->this, values, sz);
                 if (jerry_value_is_error(rval)) {
 #ifdef INSTRUMENT_CALLBACKS
                     DBG_PRINT("callback %d had error; creator: %s, "
                               "caller: %s\n",
-                              id, cb_map[id]->creator, cb_map[id]->caller);
+                              id, cb->creator, cb->caller);
 #endif
-                    zjs_print_error_message(rval, cb_map[id]->js_func);
+                    zjs_print_error_message(rval, cb->js_func);
                 }
             }
 
             // ensure the callback wasn't deleted by the previous calls
-            if (cb_map[id]) {
-                if (cb_map[id]->post) {
-                    cb_map[id]->post(cb_map[id]->handle, rval);
+            cb = get_cb(id);
+            if (cb) {
+                if (cb->post) {
+                    cb->post(cb->handle, rval);
                 }
-                if (GET_ONCE(cb_map[id]->flags)) {
+                if (GET_ONCE(cb->flags)) {
                     zjs_remove_callback_priv(id, false);
                 }
             }
-        } else if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_C &&
-                   cb_map[id]->function) {
-            cb_map[id]->function(cb_map[id]->handle, data);
+        } else if (GET_TYPE(cb->flags) == CALLBACK_TYPE_C &&
+                   cb->function) {
+            cb->function(cb->handle, data);
         }
     }
     CB_UNLOCK();
 }
 
+static void call_coalesced(zjs_callback_id id)
+{
+    // effects: calls a coalescing callback with its latest args; JS callbacks
+    //            get the number of replaced signals as an extra last arg
+    zjs_callback_t *cb = get_cb(id);
+    if (!cb || !cb->coalesce) {
+        return;
+    }
+    coalesce_slot_t *slot = cb->coalesce;
+
+    // copy out so signals during the call start a new delivery
+    u32_t args[slot->max_size / sizeof(u32_t) + 1];
+    IRQ_LOCK();
+    u32_t size = slot->size;
+    memcpy(args, slot->args, size);
+    slot->delivered = slot->dropped;
+    slot->dropped = 0;
+    slot->pending = false;
+    IRQ_UNLOCK();
+
+    if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+        int argc = size / sizeof(jerry_value_t);
+        jerry_value_t argv[argc + 1];
+        for (int i = 0; i < argc; i++) {
+            argv[i] = (jerry_value_t)args[i];
+        }
+        argv[argc] = jerry_create_number(slot->delivered);
+        zjs_call_callback(id, argv, argc + 1);
+        for (int i = 0; i <= argc; i++) {
+            jerry_release_value(argv[i]);
+        }
+    } else {
+        zjs_call_callback(id, size ? args : NULL, size);
+    }
+}
+
+static void service_record(u32_t id, u8_t value, u32_t *data, u16_t size)
+{
+#ifdef ZJS_LOOP_STATS
+    u32_t start = zjs_port_get_cycles();
+    u32_t wait_us = zjs_port_cycles_to_us(start - data[0]);
+    zjs_callback_t *origin_cb = get_cb(id);
+    const char *origin = origin_cb ? origin_cb->origin : NULL;
+#endif
+    data += STAMP_SIZE32;
+    size -= STAMP_SIZE32;
+
+    switch (value) {
+    case CB_FLUSH_ONE:
+        DBG_PRINT("flushed callback %d, freeing\n", id);
+        zjs_free_callback(id);
+        break;
+
+    case CB_FLUSH_ALL:
+        DBG_PRINT("flushed all callbacks, freeing\n");
+        for (u32_t i = 0; i < cb_size; i++) {
+            if (cb_map[i].cb) {
+                zjs_free_callback(cb_map[i].cb->id);
+            }
+        }
+        break;
+
+    case CB_COALESCED:
+        call_coalesced(id);
+        break;
+
+    default:
+#ifdef DEBUG_CALLBACKS
+        DBG_PRINT("calling callback. id=%u, args=%p, sz=%u\n", id, data,
+                  size);
+#endif
+        if (size) {
+            zjs_callback_t *cb = get_cb(id);
+            bool is_js = cb && GET_TYPE(cb->flags) == CALLBACK_TYPE_JS;
+            zjs_call_callback(id, data, size);
+            if (is_js) {
+                for (int i = 0; i < size; i++)
+                    jerry_release_value((jerry_value_t)data[i]);
+            }
+        } else {
+            zjs_call_callback(id, NULL, 0);
+        }
+    }
+
+#ifdef ZJS_LOOP_STATS
+    if (origin && value != CB_FLUSH_ONE && value != CB_FLUSH_ALL) {
+        u32_t run_us = zjs_port_cycles_to_us(zjs_port_get_cycles() - start);
+        record_latency(find_latency(-1, origin, true), wait_us, run_us);
+        // skip callbacks that were freed by the call
+        if (get_cb(id)) {
+            record_latency(find_latency(id, origin, true), wait_us, run_us);
+        }
+    }
+#endif
+}
+
 u8_t zjs_service_callbacks(void)
 {
-    if (zjs_ringbuf_error_count > zjs_ringbuf_error_max) {
-        ERR_PRINT("%d ringbuf put errors (last rval=%d)\n",
-                  zjs_ringbuf_error_count, zjs_ringbuf_last_error);
-        zjs_ringbuf_error_max = zjs_ringbuf_error_count * 2;
-        zjs_ringbuf_error_count = 0;
+    if (zjs_queue_error_count > zjs_queue_error_max) {
+        ERR_PRINT("%d callback queue put errors (last rval=%d)\n",
+                  zjs_queue_error_count, zjs_queue_last_error);
+        zjs_queue_error_max = zjs_queue_error_count * 2;
+        zjs_queue_error_count = 0;
     }
 
     u8_t serviced = 0;
-    if (ring_buf_initialized) {
+    if (cb_queue_initialized) {
 #ifdef ZJS_PRINT_CALLBACK_STATS
         u8_t header_printed = 0;
-        u32_t num_callbacks = 0;
 #endif
-        u16_t count = 0;
-        while (count++ < ZJS_MAX_CB_LOOP_ITERATION) {
-            int ret;
-            u16_t id;
-            u8_t value;
-            u8_t size = 0;
-            // set size = 0 to check if there is an item in the ring buffer
-            RB_LOCK();
-            ret = zjs_port_ring_buf_get(&ring_buffer, &id, &value, NULL, &size);
-            RB_UNLOCK();
-            if (ret == -EMSGSIZE || ret == 0) {
-                serviced = 1;
-                // item in ring buffer with size > 0, has args
-                // pull from ring buffer
-                u8_t sz = size;
-                u32_t data[sz];
-                if (ret == -EMSGSIZE) {
-                    RB_LOCK();
-                    ret = zjs_port_ring_buf_get(&ring_buffer, &id, &value, data,
-                                                &sz);
-                    RB_UNLOCK();
-                    if (ret != 0) {
-                        ERR_PRINT("pulling from ring buffer: ret = %u\n", ret);
-                        break;
-                    }
-#ifdef DEBUG_CALLBACKS
-                    DBG_PRINT("calling callback with args. id=%u, args=%p, "
-                              "sz=%u, ret=%i\n", id, data, sz, ret);
-#endif
-                    bool is_js = GET_TYPE(cb_map[id]->flags) ==
-                        CALLBACK_TYPE_JS;
-                    zjs_call_callback(id, data, sz);
-                    if (is_js) {
-                        for (int i = 0; i < sz; i++)
-                            jerry_release_value((jerry_value_t)data[i]);
-                    }
-                } else if (ret == 0) {
-                    // check for flush commands
-                    switch (value) {
-                    case CB_FLUSH_ONE:
-                        DBG_PRINT("flushed callback %d, freeing\n", id);
-                        zjs_free_callback(id);
-                        break;
+        // drain batches in place, then hand them back to producers at once;
+        //   records stay valid until zjs_queue_release
+        u32_t start = zjs_port_get_cycles();
+        u32_t count = 0;
+        bool low_serviced = false;
+        while (1) {
+            // always make some progress, even if one callback ate the budget
+            bool in_budget = count == 0 ||
+                zjs_port_cycles_to_us(zjs_port_get_cycles() - start) <
+                cb_budget_us;
+            if (!in_budget && low_serviced) {
+                break;
+            }
 
-                    case CB_FLUSH_ALL:
-                        DBG_PRINT("flushed all callbacks, freeing\n");
-                        for (int i = 0; i < cb_size; i++)
-                            zjs_free_callback(i);
+            u32_t id;
+            u8_t value;
+            u16_t size;
+            u32_t *data = NULL;
+            if (in_budget) {
+                data = zjs_queue_peek(&cb_high_queue, &id, &value, &size);
+            }
+            if (data) {
+                service_record(id, value, data, size);
+                uncount_record(id, value, true);
+            } else {
+                // past the budget, still let one low priority callback run so
+                //   a flood of high priority ones can't starve the rest
+                data = zjs_queue_peek(&cb_queue, &id, &value, &size);
+                if (data) {
+                    service_record(id, value, data, size);
+                    uncount_record(id, value, false);
+                } else {
+                    // the spill list only holds signals newer than the queues
+                    spill_entry_t *entry = unspill_callback();
+                    if (!entry) {
+                        // no more committed items anywhere
                         break;
-
-                    default:
-                        // item in ring buffer with size == 0, no args
-#ifdef DEBUG_CALLBACKS
-                        DBG_PRINT("calling callback with no args, "
-                                  "original vals id=%u, size=%u, ret=%i\n",
-                                  id, size, ret);
-#endif
-                        zjs_call_callback(id, NULL, 0);
                     }
+                    id = entry->id;
+                    size = entry->size;
+                    service_record(id, entry->value, entry->data, size);
+                    uncount_record(id, entry->value, false);
+                    zjs_free(entry);
                 }
+                low_serviced = true;
+            }
+            count++;
+            serviced = 1;
 #ifdef ZJS_PRINT_CALLBACK_STATS
-                if (!header_printed) {
-                    ZJS_PRINT("\n--------- Callback Stats ------------\n");
-                    header_printed = 1;
-                }
-                if (cb_map[id]) {
-                    ZJS_PRINT("[cb stats] Callback[%u]: type=%s, arg_sz=%u\n", id,
-                              (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) ? "JS" : "C",
-                              size);
-                }
-                num_callbacks++;
+            if (!header_printed) {
+                ZJS_PRINT("\n--------- Callback Stats ------------\n");
+                header_printed = 1;
+            }
+            zjs_callback_t *cb = get_cb(id);
+            if (cb) {
+                ZJS_PRINT("[cb stats] Callback[%u]: type=%s, arg_sz=%u\n", id,
+                          (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) ? "JS" : "C",
+                          size);
+            }
 #endif
-            } else {
-                // no more items in ring buffer
+            if (!in_budget) {
                 break;
             }
         }
+        zjs_queue_release(&cb_high_queue);
+        zjs_queue_release(&cb_queue);
+        if (bp_paused && pending_bytes() <= CB_LOW_WATER) {
+            set_backpressure(false);
+        }
 #ifdef ZJS_PRINT_CALLBACK_STATS
-        if (num_callbacks) {
+        if (count) {
             ZJS_PRINT("[cb stats] Number of Callbacks (this service): %u\n",
-                      num_callbacks);
-            ZJS_PRINT("[cb stats] Max Callbacks Per Service: %u\n",
-                      ZJS_MAX_CB_LOOP_ITERATION);
+                      count);
+            ZJS_PRINT("[cb stats] Time Spent: %u us (budget %u us)\n",
+                      zjs_port_cycles_to_us(zjs_port_get_cycles() - start),
+                      cb_budget_us);
             ZJS_PRINT("------------- End ----------------\n");
         }
 #endif
@@ -655,7 +1223,160 @@ u8_t zjs_service_callbacks(void)
     return serviced;
 }
 
-void zjs_defer_work(zjs_deferred_work callback, const void *buffer, u32_t bytes)
+#ifdef ZJS_LOOP_STATS
+bool zjs_get_callback_latency(u32_t index, zjs_callback_latency_t *entry)
+{
+    for (u32_t i = 0; i < LATENCY_MODULES + LATENCY_CALLBACKS; i++) {
+        if (latency[i].module && index-- == 0) {
+            *entry = latency[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+u32_t zjs_latency_percentile(const u16_t *hist, double percentile)
+{
+    u32_t total = 0;
+    for (int i = 0; i < ZJS_LATENCY_BUCKETS; i++) {
+        total += hist[i];
+    }
+    double target = total * percentile / 100;
+    u32_t seen = 0;
+    for (int i = 0; i < ZJS_LATENCY_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen && seen >= target) {
+            return ((u32_t)1 << (i + 1)) - 1;
+        }
+    }
+    return 0;
+}
+
+static const char *module_name(const char *file)
+{
+    // effects: strips the directory from a source file path
+    const char *name = strrchr(file, '/');
+    return name ? name + 1 : file;
+}
+
+void zjs_print_callback_latency(void)
+{
+    ZJS_PRINT("\n--------- Callback Latency (us) ---------\n");
+    ZJS_PRINT("%-24s %8s %8s %8s %8s %8s\n", "module / callback", "count",
+              "wait p99", "wait max", "run p99", "run max");
+    for (u32_t i = 0; i < LATENCY_MODULES + LATENCY_CALLBACKS; i++) {
+        zjs_callback_latency_t *entry = &latency[i];
+        if (!entry->module) {
+            continue;
+        }
+        char label[25];
+        if (entry->id < 0) {
+            snprintf(label, sizeof(label), "%s", module_name(entry->module));
+        } else {
+            snprintf(label, sizeof(label), "  [%d] %s", (int)entry->id,
+                     module_name(entry->module));
+        }
+        ZJS_PRINT("%-24s %8u %8u %8u %8u %8u\n", label,
+                  (unsigned int)entry->count,
+                  (unsigned int)zjs_latency_percentile(entry->wait_hist, 99),
+                  (unsigned int)entry->wait_max_us,
+                  (unsigned int)zjs_latency_percentile(entry->run_hist, 99),
+                  (unsigned int)entry->run_max_us);
+    }
+    ZJS_PRINT("------------------ End ------------------\n");
+}
+#endif
+
+bool zjs_callbacks_pending(void)
+{
+    return zjs_queue_used(&cb_high_queue) || zjs_queue_used(&cb_queue) ||
+           spill_head;
+}
+
+void zjs_set_callback_budget(u32_t us)
+{
+    cb_budget_us = us;
+}
+
+bool zjs_set_callback_priority(zjs_callback_id id, u8_t priority)
+{
+    CB_LOCK();
+    zjs_callback_t *cb = get_cb(id);
+    if (cb) {
+        SET_HIGH_PRIO(cb->flags, priority == ZJS_CALLBACK_PRIORITY_HIGH);
+    }
+    CB_UNLOCK();
+    return cb != NULL;
+}
+
+bool zjs_add_backpressure(zjs_backpressure_func func, void *handle)
+{
+    for (int i = 0; i < MAX_BACKPRESSURE; i++) {
+        if (!bp_list[i].func) {
+            bp_list[i].handle = handle;
+            bp_list[i].func = func;
+            return true;
+        }
+    }
+    DBG_PRINT("no room for backpressure function\n");
+    return false;
+}
+
+void zjs_remove_backpressure(zjs_backpressure_func func, void *handle)
+{
+    for (int i = 0; i < MAX_BACKPRESSURE; i++) {
+        if (bp_list[i].func == func && bp_list[i].handle == handle) {
+            bp_list[i].func = NULL;
+            bp_list[i].handle = NULL;
+        }
+    }
+}
+
+bool zjs_coalesce_callback(zjs_callback_id id, u32_t max_size)
+{
+    // requires: only run from main thread, before the callback is signaled
+    u32_t size32 = (max_size + 3) / 4;
+    coalesce_slot_t *slot = zjs_malloc(sizeof(coalesce_slot_t) +
+                                       size32 * sizeof(u32_t));
+    if (!slot) {
+        DBG_PRINT("error allocating space for coalescing slot\n");
+        return false;
+    }
+    memset(slot, 0, sizeof(coalesce_slot_t));
+    slot->max_size = size32 * sizeof(u32_t);
+
+    CB_LOCK();
+    bool rval = false;
+    zjs_callback_t *cb = get_cb(id);
+    if (cb && !cb->coalesce) {
+        cb->coalesce = slot;
+        rval = true;
+    }
+    CB_UNLOCK();
+    if (!rval) {
+        zjs_free(slot);
+    }
+    return rval;
+}
+
+u32_t zjs_get_coalesced_count(zjs_callback_id id)
+{
+    zjs_callback_t *cb = get_cb(id);
+    if (!cb || !cb->coalesce) {
+        return 0;
+    }
+    return cb->coalesce->delivered;
+}
+
+void zjs_get_callback_stats(zjs_callback_stats_t *stats)
+{
+    *stats = cb_stats;
+    stats->pending = pending_bytes();
+    stats->queue_size = ZJS_CALLBACK_BUF_SIZE;
+}
+
+static void defer_work(zjs_callback_id id, zjs_deferred_work callback,
+                       const void *buffer, u32_t bytes)
 {
     DBG_PRINT("deferring work: %d bytes\n", bytes);
     int len = sizeof(deferred_work_t) + bytes;
@@ -680,5 +1401,16 @@ void zjs_defer_work(zjs_deferred_work callback, const void *buffer, u32_t bytes)
     ZJS_PRINT("\n");
 #endif
     // assert: if buffer is null, bytes should be 0, and vice versa
-    zjs_signal_callback(defer_id, buf, len);
+    zjs_signal_callback(id, buf, len);
+}
+
+void zjs_defer_work(zjs_deferred_work callback, const void *buffer, u32_t bytes)
+{
+    defer_work(defer_id, callback, buffer, bytes);
+}
+
+void zjs_defer_io_work(zjs_deferred_work callback, const void *buffer,
+                       u32_t bytes)
+{
+    defer_work(defer_io_id, callback, buffer, bytes);
 }
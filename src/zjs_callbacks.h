@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef SRC_ZJS_CALLBACKS_H_
 #define SRC_ZJS_CALLBACKS_H_
@@ -12,7 +12,7 @@
 //#define INSTRUMENT_CALLBACKS
 #endif
 
-typedef s16_t zjs_callback_id;
+typedef s32_t zjs_callback_id;
 
 /*
  * Function that will be called AFTER the JS function is called.
@@ -79,8 +79,8 @@ void signal_callback_priv(zjs_callback_id id,
  * module; this allows the system to fairly share CPU time as well as prevent
  * large recursion loops. Signaling a callback will cause the callback to be
  * called only once, and will NOT remove the callback from the list. You can
- * signal callbacks multiple times, but if the callback has not been serviced
- * between signaling, it will only get called once.
+ * signal callbacks multiple times, and each signal is delivered with its own
+ * args, unless the callback was set up with zjs_coalesce_callback().
  *
  * For a JS callback, the arguments are of type jerry_value_t and they will be
  * acquired by the callback module and released when the callback fires. So the
@@ -90,6 +90,10 @@ void signal_callback_priv(zjs_callback_id id,
  * to the callback module and must be managed by the caller and perhaps freed
  * in the post-callback function if appropriate.
  *
+ * If the callback queue is full, signals made outside an ISR are copied to a
+ * bounded list on the heap and still delivered in order; signals that fit
+ * nowhere are dropped and counted in zjs_get_callback_stats().
+ *
  * @param id            ID returned from zjs_add_callback
  * @param args          Arguments given to the JS/C callback
  * @param size          Size of arguments (in bytes)
@@ -104,10 +108,10 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
                                   jerry_value_t this,
                                   void *handle,
                                   zjs_post_callback_func post,
-                                  u8_t once
+                                  u8_t once,
+                                  const char *file
 #ifdef INSTRUMENT_CALLBACKS
                                   ,
-                                  const char *file,
                                   const char *func);
 #else
                                   );
@@ -125,7 +129,7 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
 *                        reference this CB
 */
 #define zjs_add_callback(func, this, handle, post) \
-    add_callback_priv(func, this, handle, post, 0)
+    add_callback_priv(func, this, handle, post, 0, __FILE__)
 
 /*
 * Add a JS callback that will only get called once. After it is called it will
@@ -139,7 +143,7 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
 *                        reference this CB
 */
 #define zjs_add_callback_once(func, this, handle, post) \
-    add_callback_priv(func, this, handle, post, 1);
+    add_callback_priv(func, this, handle, post, 1, __FILE__);
 #else
 #define zjs_add_callback(func, this, handle, post) \
     add_callback_priv(func, this, handle, post, 0, __FILE__, __func__)
@@ -147,6 +151,10 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
     add_callback_priv(func, this, handle, post, 1, __FILE__, __func__);
 #endif
 
+zjs_callback_id add_c_callback_priv(void *handle,
+                                    zjs_c_callback_func callback,
+                                    const char *file);
+
 /*
  * Add/register a C callback
  *
@@ -155,7 +163,54 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
  *
  * @return              ID for the C callback
  */
-zjs_callback_id zjs_add_c_callback(void *handle, zjs_c_callback_func callback);
+#define zjs_add_c_callback(handle, callback) \
+    add_c_callback_priv(handle, callback, __FILE__)
+
+/*
+ * Make a callback coalesce signals, for level-style sources such as sensor
+ * readings where only the newest value matters. While a signal is waiting to
+ * be serviced, further signals replace its args in place instead of queueing
+ * again, and the replaced args are released. JS callbacks receive the number
+ * of replaced signals as an extra last argument; C callbacks can query it with
+ * zjs_get_coalesced_count().
+ *
+ * @param id            ID of callback
+ * @param max_size      Largest args size that will be signaled, in bytes
+ *
+ * @return              true on success
+ */
+bool zjs_coalesce_callback(zjs_callback_id id, u32_t max_size);
+
+/*
+ * Get the number of signals that were replaced by newer ones before the
+ * current call of a coalescing callback
+ *
+ * @param id            ID of callback
+ *
+ * @return              Number of dropped signals, 0 if not coalescing
+ */
+u32_t zjs_get_coalesced_count(zjs_callback_id id);
+
+#define ZJS_CALLBACK_PRIORITY_LOW   0
+#define ZJS_CALLBACK_PRIORITY_HIGH  1
+
+/*
+ * Set the priority a callback is serviced with
+ *
+ * Signals for high priority callbacks are serviced before any pending low
+ * priority ones, and keep being serviced after the time budget runs out.
+ * Signals sent from interrupt context are always treated as high priority.
+ * A callback's signals are always delivered in the order they were sent, so
+ * while it still has signals in the low priority queue new ones go there too,
+ * and if the high priority queue is full while it has signals in it new ones
+ * are dropped.
+ *
+ * @param id            ID of callback
+ * @param priority      ZJS_CALLBACK_PRIORITY_LOW or ZJS_CALLBACK_PRIORITY_HIGH
+ *
+ * @return              true on success
+ */
+bool zjs_set_callback_priority(zjs_callback_id id, u8_t priority);
 
 /*
  * Call a callback immediately. This should only be used when absolutely needed
@@ -170,15 +225,131 @@ zjs_callback_id zjs_add_c_callback(void *handle, zjs_c_callback_func callback);
  */
 void zjs_call_callback(zjs_callback_id id, const void *data, u32_t sz);
 
+/*
+ * Function called when the callback queue passes its high-water mark, and again
+ * once it has drained below its low-water mark. This may be called from an
+ * ISR, so it must be interrupt safe; typically it just masks or unmasks the
+ * source of events, such as a UART RX interrupt.
+ *
+ * @param handle        Handle given to zjs_add_backpressure()
+ * @param pause         true to stop producing events, false to resume
+ */
+typedef void (*zjs_backpressure_func)(void *handle, bool pause);
+
+/*
+ * Register a producer to be paused and resumed as the callback queue fills
+ *
+ * @param func          Function to be called on pause and resume
+ * @param handle        Module specific handle
+ *
+ * @return              false if there is no room for more producers
+ */
+bool zjs_add_backpressure(zjs_backpressure_func func, void *handle);
+
+/*
+ * Unregister a producer added with zjs_add_backpressure()
+ *
+ * @param func          Function given to zjs_add_backpressure()
+ * @param handle        Handle given to zjs_add_backpressure()
+ */
+void zjs_remove_backpressure(zjs_backpressure_func func, void *handle);
+
+typedef struct zjs_callback_stats {
+    u32_t dropped;     // signals lost because there was no room for them
+    u32_t spilled;     // signals that overflowed to the heap
+    u32_t pauses;      // times producers were asked to pause
+    u32_t high_water;  // most bytes ever pending, including spilled signals
+    u32_t pending;     // bytes pending now
+    u32_t queue_size;  // size of the callback queue in bytes
+} zjs_callback_stats_t;
+
+/*
+ * Get counters describing how close the callback queue has come to overflowing
+ *
+ * @param stats         Receives the current counters
+ */
+void zjs_get_callback_stats(zjs_callback_stats_t *stats);
+
+#ifdef ZJS_LOOP_STATS
+// log2 histogram buckets kept for callback latency, the last one also counts
+// everything longer
+#define ZJS_LATENCY_BUCKETS  20
+
+typedef struct zjs_callback_latency {
+    zjs_callback_id id;   // callback ID, or -1 for a module total
+    const char *module;   // source file that created the callback(s)
+    u32_t count;          // number of dispatches measured
+    u32_t wait_max_us;    // longest time from signal to dispatch
+    u32_t run_max_us;     // longest time spent in the handler
+    u64_t wait_sum_us;
+    u64_t run_sum_us;
+    u16_t wait_hist[ZJS_LATENCY_BUCKETS];  // saturating counts
+    u16_t run_hist[ZJS_LATENCY_BUCKETS];
+} zjs_callback_latency_t;
+
+/*
+ * Get latency statistics for one module or callback
+ *
+ * Modules are identified by the source file that created the callback, and
+ * their totals come first. A fixed number of live callbacks are tracked
+ * individually after that; others only count toward their module.
+ *
+ * @param index         Entry to read, starting at 0
+ * @param entry         Receives the entry
+ *
+ * @return              true if there is an entry at index
+ */
+bool zjs_get_callback_latency(u32_t index, zjs_callback_latency_t *entry);
+
+/*
+ * Get the upper bound of the bucket a given share of dispatches fell in
+ *
+ * @param hist          Histogram from a zjs_callback_latency_t
+ * @param percentile    Share of dispatches, 0 to 100
+ *
+ * @return              Bucket upper bound in microseconds
+ */
+u32_t zjs_latency_percentile(const u16_t *hist, double percentile);
+
+/*
+ * Print a latency table for every module and tracked callback
+ */
+void zjs_print_callback_latency(void);
+#endif
+
 /*
  * Service the callback module. Any callback's that have been signaled will
- * be serviced and the signal flag will be unset.
+ * be serviced and the signal flag will be unset, until the time budget runs
+ * out. High priority callbacks are serviced first; after the budget at most one
+ * more low priority callback is serviced so they are never starved.
  *
  * @return              1 if any callbacks were processed
  *                      0 if no callbacks were processed
  */
 u8_t zjs_service_callbacks(void);
 
+/*
+ * Check whether any signaled callbacks are still waiting to be serviced
+ *
+ * @return              true if zjs_service_callbacks() has more work
+ */
+bool zjs_callbacks_pending(void);
+
+// default time in microseconds that one zjs_service_callbacks() call may spend
+// before continuing execution; any additional callbacks will be serviced on
+// the next time around the main loop
+#ifndef ZJS_CALLBACK_BUDGET_US
+#define ZJS_CALLBACK_BUDGET_US  10000
+#endif
+
+/*
+ * Set how long one zjs_service_callbacks() call may run before returning to
+ * the main loop
+ *
+ * @param us            Time budget in microseconds
+ */
+void zjs_set_callback_budget(u32_t us);
+
 typedef void (*zjs_deferred_work)(const void *buffer, u32_t length);
 
 /**
@@ -201,4 +372,17 @@ typedef void (*zjs_deferred_work)(const void *buffer, u32_t length);
 void zjs_defer_work(zjs_deferred_work callback, const void *buffer,
                     u32_t bytes);
 
+/**
+ * Defers I/O completion work to a high priority callback on the main thread
+ *
+ * Same as zjs_defer_work(), but the work is serviced ahead of ordinary
+ * callbacks. Use it for received data and accepted connections.
+ *
+ * @param callback      Function to be called from main thread to process work
+ * @param buffer        Data needed to call function
+ * @param bytes         Size of buffer
+ */
+void zjs_defer_io_work(zjs_deferred_work callback, const void *buffer,
+                       u32_t bytes);
+
 #endif /* SRC_ZJS_CALLBACKS_H_ */
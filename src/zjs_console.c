@@ -30,7 +30,7 @@
 #define IS_INT    1
 #define IS_UINT   2
 
-static jerry_value_t gbl_time_obj;
+static jerry_value_t gbl_time_obj = 0;
 
 static int is_int(jerry_value_t val)
 {
@@ -254,7 +254,9 @@ void zjs_console_init(void)
 
 void zjs_console_cleanup()
 {
+    // the module may never have been initialized, see zjs_modules_init
     jerry_release_value(gbl_time_obj);
+    gbl_time_obj = 0;
 }
 
 #endif  // BUILD_MODULE_CONSOLE
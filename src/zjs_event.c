@@ -19,21 +19,223 @@ typedef struct listener {
     struct listener *next;
 } listener_t;
 
-// allocate sizeof(event_t) + len(name)
+// a slot in an emitter's event table, empty if id is ZJS_EVENT_NONE
 typedef struct event {
-    struct event *next;
+    zjs_event_id id;
+    u16_t order;  // index among the emitter's events in the order added
     listener_t *listeners;
-    int namelen;
-    char name[1];
 } event_t;
 
+// an event registered with zjs_register_deferred_event; the token is the id
+//   of a C callback whose handle is this struct
+typedef struct deferred {
+    jerry_value_t obj;
+    zjs_event_id id;
+    zjs_event_token token;
+    zjs_pre_emit pre;
+    zjs_post_emit post;
+    struct deferred *next;
+} deferred_t;
+
 typedef struct emitter {
     int max_listeners;
-    event_t *events;
+    event_t *events;  // open-addressed by event id, NULL until first listener
+    u16_t size;       // slots in events, a power of 2 or 0
+    u16_t count;      // slots in use
+    deferred_t *deferred;
     void *user_handle;
     zjs_event_free user_free;
 } emitter_t;
 
+// allocate sizeof(atom_t) + len(name)
+typedef struct atom {
+    u32_t hash;
+    char name[1];
+} atom_t;
+
+// interned event names, atom id - 1 indexes atoms
+static atom_t **atoms = NULL;
+static u32_t atom_count = 0;
+static u32_t atom_capacity = 0;
+
+// open-addressed table from name hash to atom id, a power of 2 in size
+static zjs_event_id *atom_index = NULL;
+static u32_t atom_index_size = 0;
+
+static u32_t hash_name(const char *name)
+{
+    // FNV-1a
+    u32_t hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (u8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+static zjs_event_id find_atom(const char *name, u32_t hash)
+{
+    if (!atom_index_size) {
+        return ZJS_EVENT_NONE;
+    }
+
+    u32_t mask = atom_index_size - 1;
+    for (u32_t i = hash & mask; atom_index[i]; i = (i + 1) & mask) {
+        atom_t *atom = atoms[atom_index[i] - 1];
+        if (atom->hash == hash && strequal(atom->name, name)) {
+            return atom_index[i];
+        }
+    }
+    return ZJS_EVENT_NONE;
+}
+
+static void index_atom(zjs_event_id *index, u32_t size, zjs_event_id id)
+{
+    // requires: index has an empty slot
+    u32_t mask = size - 1;
+    u32_t i = atoms[id - 1]->hash & mask;
+    while (index[i]) {
+        i = (i + 1) & mask;
+    }
+    index[i] = id;
+}
+
+static bool reserve_atom()
+{
+    // effects: makes room for one more atom, keeping the index at most 3/4
+    //            full; returns false if out of memory or out of ids
+    if (atom_count >= 0xffff) {
+        return false;
+    }
+
+    if (atom_count == atom_capacity) {
+        u32_t capacity = atom_capacity ? atom_capacity * 2 : 16;
+        atom_t **list = zjs_malloc(capacity * sizeof(atom_t *));
+        if (!list) {
+            return false;
+        }
+        if (atom_count) {
+            memcpy(list, atoms, atom_count * sizeof(atom_t *));
+        }
+        zjs_free(atoms);
+        atoms = list;
+        atom_capacity = capacity;
+    }
+
+    if ((atom_count + 1) * 4 > atom_index_size * 3) {
+        u32_t size = atom_index_size ? atom_index_size * 2 : 32;
+        zjs_event_id *index = zjs_malloc(size * sizeof(zjs_event_id));
+        if (!index) {
+            return false;
+        }
+        memset(index, 0, size * sizeof(zjs_event_id));
+        for (u32_t i = 0; i < atom_count; i++) {
+            index_atom(index, size, i + 1);
+        }
+        zjs_free(atom_index);
+        atom_index = index;
+        atom_index_size = size;
+    }
+    return true;
+}
+
+zjs_event_id zjs_event_intern(const char *name)
+{
+    u32_t hash = hash_name(name);
+    zjs_event_id id = find_atom(name, hash);
+    if (id != ZJS_EVENT_NONE) {
+        return id;
+    }
+
+    if (!reserve_atom()) {
+        return ZJS_EVENT_NONE;
+    }
+    atom_t *atom = zjs_malloc(sizeof(atom_t) + strlen(name));
+    if (!atom) {
+        return ZJS_EVENT_NONE;
+    }
+    atom->hash = hash;
+    strcpy(atom->name, name);
+
+    atoms[atom_count++] = atom;
+    id = (zjs_event_id)atom_count;
+    index_atom(atom_index, atom_index_size, id);
+    return id;
+}
+
+zjs_event_id zjs_event_lookup(const char *name)
+{
+    return find_atom(name, hash_name(name));
+}
+
+const char *zjs_event_name(zjs_event_id id)
+{
+    if (id == ZJS_EVENT_NONE || id > atom_count) {
+        return NULL;
+    }
+    return atoms[id - 1]->name;
+}
+
+static event_t *find_event(emitter_t *handle, zjs_event_id id)
+{
+    if (!handle->size || id == ZJS_EVENT_NONE) {
+        return NULL;
+    }
+
+    // atoms are handed out in sequence, so the low bits spread them well
+    u32_t mask = handle->size - 1;
+    for (u32_t i = id & mask; handle->events[i].id; i = (i + 1) & mask) {
+        if (handle->events[i].id == id) {
+            return &handle->events[i];
+        }
+    }
+    return NULL;
+}
+
+static event_t *insert_event(event_t *events, u32_t size, zjs_event_id id)
+{
+    // requires: events has an empty slot
+    u32_t mask = size - 1;
+    u32_t i = id & mask;
+    while (events[i].id) {
+        i = (i + 1) & mask;
+    }
+    events[i].id = id;
+    return &events[i];
+}
+
+static event_t *add_event(emitter_t *handle, zjs_event_id id)
+{
+    // requires: id is a valid atom not yet in the table
+    //  effects: adds an event slot, growing the table to keep it at most 3/4
+    //             full; returns NULL if out of memory
+    if ((handle->count + 1) * 4 > handle->size * 3) {
+        if (handle->size >= 0x8000) {
+            return NULL;
+        }
+        u32_t size = handle->size ? handle->size * 2 : 4;
+        event_t *events = zjs_malloc(size * sizeof(event_t));
+        if (!events) {
+            return NULL;
+        }
+        memset(events, 0, size * sizeof(event_t));
+        for (u32_t i = 0; i < handle->size; i++) {
+            if (handle->events[i].id) {
+                event_t *event = insert_event(events, size,
+                                              handle->events[i].id);
+                event->order = handle->events[i].order;
+                event->listeners = handle->events[i].listeners;
+            }
+        }
+        zjs_free(handle->events);
+        handle->events = events;
+        handle->size = size;
+    }
+
+    event_t *event = insert_event(handle->events, handle->size, id);
+    event->order = handle->count++;
+    return event;
+}
+
 static void free_listener(void *ptr)
 {
     listener_t *listener = (listener_t *)ptr;
@@ -41,6 +243,21 @@ static void free_listener(void *ptr)
     zjs_free(listener);
 }
 
+static void free_deferred(void *ptr)
+{
+    deferred_t *deferred = (deferred_t *)ptr;
+    zjs_remove_callback(deferred->token);
+    zjs_free(deferred);
+}
+
+static void free_listeners(emitter_t *handle)
+{
+    // empty slots have no listeners
+    for (u32_t i = 0; i < handle->size; i++) {
+        ZJS_LIST_FREE(listener_t, handle->events[i].listeners, free_listener);
+    }
+}
+
 static void zjs_event_proto_free_cb(void *native)
 {
     zjs_event_emitter_prototype = 0;
@@ -55,12 +272,9 @@ static const jerry_object_native_info_t event_proto_type_info = {
 static void zjs_emitter_free_cb(void *native)
 {
     emitter_t *handle = (emitter_t *)native;
-    event_t *event = handle->events;
-    while (event) {
-        ZJS_LIST_FREE(listener_t, event->listeners, free_listener);
-        event = event->next;
-    }
-    ZJS_LIST_FREE(event_t, handle->events, zjs_free);
+    free_listeners(handle);
+    zjs_free(handle->events);
+    ZJS_LIST_FREE(deferred_t, handle->deferred, free_deferred);
     if (handle->user_free) {
         handle->user_free(handle->user_handle);
     }
@@ -71,11 +285,6 @@ static const jerry_object_native_info_t emitter_type_info = {
     .free_cb = zjs_emitter_free_cb
 };
 
-static int compare_name(event_t *event, const char *name)
-{
-    return strncmp(event->name, name, event->namelen + 1);
-}
-
 jerry_value_t zjs_add_event_listener(jerry_value_t obj, const char *event_name,
                                      jerry_value_t func)
 {
@@ -83,24 +292,22 @@ jerry_value_t zjs_add_event_listener(jerry_value_t obj, const char *event_name,
     //  returns: an error, or 0 value on success
     ZJS_GET_HANDLE_ALT(obj, emitter_t, handle, emitter_type_info);
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       event_name);
+    zjs_event_id id = zjs_event_intern(event_name);
+    if (id == ZJS_EVENT_NONE) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+
+    event_t *event = find_event(handle, id);
     if (!event) {
-        int len = strlen(event_name);
-        event = (event_t *)zjs_malloc(sizeof(event_t) + len);
+        event = add_event(handle, id);
         if (!event) {
             return zjs_error_context("out of memory", 0, 0);
         }
-        event->next = NULL;
-        event->listeners = NULL;
-        event->namelen = len;
-        strcpy(event->name, event_name);
-        ZJS_LIST_APPEND(event_t, handle->events, event);
     }
 
     listener_t *listener = zjs_malloc(sizeof(listener_t));
     if (!listener) {
-        zjs_free(event);
+        // the empty event slot is harmless, leave it for next time
         return zjs_error_context("out of memory", 0, 0);
     }
 
@@ -174,8 +381,7 @@ static ZJS_DECL_FUNC(remove_listener)
         return zjs_error("out of memory");
     }
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
+    event_t *event = find_event(handle, zjs_event_lookup(name));
     listener_t *listener = NULL;
     zjs_free(name);
 
@@ -205,8 +411,7 @@ static ZJS_DECL_FUNC(remove_all_listeners)
         return zjs_error("out of memory");
     }
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
+    event_t *event = find_event(handle, zjs_event_lookup(name));
     zjs_free(name);
     if (!event) {
         return zjs_error("no event listeners found");
@@ -222,15 +427,16 @@ static ZJS_DECL_FUNC(get_event_names)
     ZJS_GET_HANDLE(this, emitter_t, handle, emitter_type_info);
 
     // FIXME: pre-register events
-    int len = ZJS_LIST_LENGTH(event_t, handle->events);
-    jerry_value_t rval = jerry_create_array(len);
-
-    event_t *event = handle->events;
-    int i = 0;
-    while (event) {
-        jerry_set_property_by_index(rval, i++,
-            jerry_create_string((jerry_char_t *)event->name));
-        event = event->next;
+    jerry_value_t rval = jerry_create_array(handle->count);
+
+    // the slots are in hash order, so place each name by when it was added;
+    //   events are never removed, so the orders are exactly 0 to count - 1
+    for (u32_t i = 0; i < handle->size; i++) {
+        if (handle->events[i].id) {
+            const char *name = zjs_event_name(handle->events[i].id);
+            ZVAL str = jerry_create_string((const jerry_char_t *)name);
+            jerry_set_property_by_index(rval, handle->events[i].order, str);
+        }
     }
 
     return rval;
@@ -268,8 +474,7 @@ static ZJS_DECL_FUNC(get_listener_count)
         return zjs_error("out of memory");
     }
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
+    event_t *event = find_event(handle, zjs_event_lookup(name));
     zjs_free(name);
     if (!event) {
         return jerry_create_number(0);
@@ -291,14 +496,13 @@ static ZJS_DECL_FUNC(get_listeners)
         return zjs_error("out of memory");
     }
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
+    event_t *event = find_event(handle, zjs_event_lookup(name));
     zjs_free(name);
     if (!event) {
         return jerry_create_array(0);
     }
 
-    int len = ZJS_LIST_LENGTH(event_t, handle->events);
+    int len = ZJS_LIST_LENGTH(listener_t, event->listeners);
     jerry_value_t rval = jerry_create_array(len);
 
     listener_t *listener = event->listeners;
@@ -319,24 +523,99 @@ typedef struct emit_event {
     char data[0];  // data is user data followed by null-terminated event name
 } emit_event_t;
 
-static void emit_event_callback(void *handle, const void *args)
+// args for deferred events, reused from one event to the next
+static jerry_value_t *arg_arena = NULL;
+static u32_t arena_size = 0;
+static u32_t arena_top = 0;  // slots used by events being emitted right now
+
+static jerry_value_t *alloc_args(u32_t count)
 {
-    const emit_event_t *emit = (const emit_event_t *)args;
+    //  effects: returns room for count args from the top of the arena, growing
+    //             it if no event is using it and taking them from the heap
+    //             otherwise; returns NULL if out of memory
+    if (arena_top + count > arena_size) {
+        if (arena_top) {
+            // an event is emitting from a listener, leave its args in place
+            return zjs_malloc(count * sizeof(jerry_value_t));
+        }
+        u32_t size = arena_size ? arena_size * 2 : ZJS_EVENT_MIN_ARGS * 2;
+        while (size < count) {
+            size *= 2;
+        }
+        jerry_value_t *arena = zjs_malloc(size * sizeof(jerry_value_t));
+        if (!arena) {
+            return NULL;
+        }
+        zjs_free(arg_arena);
+        arg_arena = arena;
+        arena_size = size;
+    }
+    jerry_value_t *argv = arg_arena + arena_top;
+    arena_top += count;
+    return argv;
+}
 
-    void *user_handle = zjs_event_get_user_handle(emit->obj);
+static void free_args(jerry_value_t *argv, u32_t count)
+{
+    // requires: argv is the last block returned by alloc_args not yet freed
+    if (argv >= arg_arena && argv < arg_arena + arena_size) {
+        arena_top -= count;
+    } else {
+        zjs_free(argv);
+    }
+}
+
+void zjs_event_cleanup()
+{
+    // process.exit() from a listener cleans up while its event still holds
+    //   args in the arena, so keep the arena for reuse then
+    if (!arena_top) {
+        zjs_free(arg_arena);
+        arg_arena = NULL;
+        arena_size = 0;
+    }
+}
+
+// payload queued by zjs_defer_emit_token, unless there is no data at all
+typedef struct deferred_args {
+    u32_t length;  // length of user data
+    char data[0];
+} deferred_args_t;
+
+static void emit_deferred(jerry_value_t obj, zjs_event_id id,
+                          zjs_pre_emit pre, zjs_post_emit post,
+                          const char *data, u32_t length)
+{
+    // effects: sets up args with pre, emits the event and cleans up with post
+    void *user_handle = zjs_event_get_user_handle(obj);
 
     // prepare arguments for the event
-    jerry_value_t argv[MAX_EVENT_ARGS];
+    u32_t room = length / sizeof(jerry_value_t);
+    if (room < ZJS_EVENT_MIN_ARGS) {
+        room = ZJS_EVENT_MIN_ARGS;
+    }
+    jerry_value_t *argv = alloc_args(room);
+    if (!argv) {
+        ERR_PRINT("out of memory\n");
+        return;
+    }
     jerry_value_t *argp = argv;
     u32_t argc = 0;
-    if (emit->pre) {
-        if (!emit->pre(user_handle, argv, &argc, emit->data, emit->length)) {
+    if (pre) {
+        if (!pre(user_handle, argv, &argc, data, length)) {
             // event cancelled
             DBG_PRINT("event cancelled\n");
+            free_args(argv, room);
             return;
         }
-        if (argc > MAX_EVENT_ARGS) {
-            ERR_PRINT("Must increase MAX_EVENT_ARGS!");
+        // room was sized from the buffer before pre ran, so zjs_copy_args
+        //   always fits; any other pre function that sets up more args than
+        //   ZJS_EVENT_MIN_ARGS has overrun argv, so neither emit nor clean up
+        if (argc > room) {
+            ERR_PRINT("pre function set up too many args!\n");
+            ZJS_ASSERT(false, "event args overrun");
+            free_args(argv, room);
+            return;
         }
     }
     if (argc == 0) {
@@ -344,14 +623,32 @@ static void emit_event_callback(void *handle, const void *args)
     }
 
     // emit the event
-    zjs_emit_event(emit->obj, emit->data + emit->length, argp, argc);
+    zjs_emit_event_id(obj, id, argp, argc);
     // TODO: possibly do something different depending on success/failure?
 
     // free args
-    if (emit->post) {
+    if (post) {
         // TODO: figure out what is needed for args here
-        emit->post(user_handle, argv, argc);
+        post(user_handle, argv, argc);
     }
+    free_args(argv, room);
+}
+
+static void emit_event_callback(void *handle, const void *args)
+{
+    const emit_event_t *emit = (const emit_event_t *)args;
+    // an unknown name still runs pre and post so they can clean up
+    zjs_event_id id = zjs_event_lookup(emit->data + emit->length);
+    emit_deferred(emit->obj, id, emit->pre, emit->post, emit->data,
+                  emit->length);
+}
+
+static void deferred_event_callback(void *handle, const void *args)
+{
+    deferred_t *deferred = (deferred_t *)handle;
+    const deferred_args_t *emit = (const deferred_args_t *)args;
+    emit_deferred(deferred->obj, deferred->id, deferred->pre, deferred->post,
+                  emit ? emit->data : NULL, emit ? emit->length : 0);
 }
 
 // a zjs_pre_emit callback
@@ -365,6 +662,19 @@ bool zjs_copy_arg(void *unused, jerry_value_t argv[], u32_t *argc,
     return true;
 }
 
+// a zjs_pre_emit callback
+bool zjs_copy_args(void *unused, jerry_value_t argv[], u32_t *argc,
+                   const char *buffer, u32_t bytes)
+{
+    // requires: buffer contains zero or more jerry_value_t's
+    ZJS_ASSERT(bytes % sizeof(jerry_value_t) == 0, "invalid data received");
+    *argc = bytes / sizeof(jerry_value_t);
+    if (*argc) {
+        memcpy(argv, buffer, bytes);
+    }
+    return true;
+}
+
 // a zjs_post_emit callback
 void zjs_release_args(void *unused, jerry_value_t argv[], u32_t argc)
 {
@@ -378,7 +688,8 @@ void zjs_defer_emit_event_priv(jerry_value_t obj, const char *event,
                                const void *buffer, int bytes,
                                zjs_pre_emit pre, zjs_post_emit post)
 {
-    // requires: don't exceed MAX_EVENT_ARGS in pre function
+    // requires: don't exceed the args room described by ZJS_EVENT_MIN_ARGS
+    //             in pre function
     //  effects: threadsafe way to schedule an event to be triggered from the
     //             main thread in the next event loop pass
     DBG_PRINT("queuing event '%s'\n", event);
@@ -399,22 +710,98 @@ void zjs_defer_emit_event_priv(jerry_value_t obj, const char *event,
     zjs_signal_callback(emit_id, buf, len);
 }
 
+zjs_event_token zjs_register_deferred_event(jerry_value_t obj,
+                                            const char *name,
+                                            zjs_pre_emit pre,
+                                            zjs_post_emit post)
+{
+    ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
+    if (!handle) {
+        ERR_PRINT("no handle found\n");
+        return ZJS_EVENT_TOKEN_NONE;
+    }
+
+    zjs_event_id id = zjs_event_intern(name);
+    deferred_t *deferred = zjs_malloc(sizeof(deferred_t));
+    if (id == ZJS_EVENT_NONE || !deferred) {
+        zjs_free(deferred);
+        return ZJS_EVENT_TOKEN_NONE;
+    }
+    deferred->token = zjs_add_c_callback(deferred, deferred_event_callback);
+    if (deferred->token == -1) {
+        zjs_free(deferred);
+        return ZJS_EVENT_TOKEN_NONE;
+    }
+    // deferred events mostly report I/O, so don't queue them behind timers
+    zjs_set_callback_priority(deferred->token, ZJS_CALLBACK_PRIORITY_HIGH);
+
+    deferred->obj = obj;
+    deferred->id = id;
+    deferred->pre = pre;
+    deferred->post = post;
+    deferred->next = handle->deferred;
+    handle->deferred = deferred;
+    return deferred->token;
+}
+
+void zjs_unregister_deferred_event(jerry_value_t obj, zjs_event_token token)
+{
+    ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
+    if (handle) {
+        deferred_t *deferred = ZJS_LIST_FIND(deferred_t, handle->deferred,
+                                             token, token);
+        if (deferred) {
+            ZJS_LIST_REMOVE(deferred_t, handle->deferred, deferred);
+            free_deferred(deferred);
+        }
+    }
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+void zjs_defer_emit_token_priv(zjs_event_token token, const void *buffer,
+                               u32_t bytes)
+{
+    if (!bytes) {
+        zjs_signal_callback(token, NULL, 0);
+        return;
+    }
+
+    int len = sizeof(deferred_args_t) + bytes;
+    char buf[len];
+    deferred_args_t *emit = (deferred_args_t *)buf;
+    emit->length = bytes;
+    memcpy(emit->data, buffer, bytes);
+    zjs_signal_callback(token, buf, len);
+}
+
 bool zjs_emit_event_priv(jerry_value_t obj, const char *event_name,
                          const jerry_value_t argv[], u32_t argc)
 {
     // effects: emits event now, should only be called from main thread
     DBG_PRINT("emitting event '%s'\n", event_name);
 
+    // a name that was never interned has no listeners on any emitter
+    zjs_event_id id = zjs_event_lookup(event_name);
+    if (id == ZJS_EVENT_NONE) {
+        DBG_PRINT("Event '%s' not found\n", event_name);
+        return false;
+    }
+    return zjs_emit_event_id_priv(obj, id, argv, argc);
+}
+
+bool zjs_emit_event_id_priv(jerry_value_t obj, zjs_event_id id,
+                            const jerry_value_t argv[], u32_t argc)
+{
+    // effects: emits event now, should only be called from main thread
     ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
     if (!handle) {
         ERR_PRINT("no handle found\n");
         return false;
     }
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       event_name);
+    event_t *event = find_event(handle, id);
     if (!event || !event->listeners) {
-        DBG_PRINT("Event '%s' not found or no listeners\n", event_name);
+        DBG_PRINT("Event %d not found or no listeners\n", id);
         return false;
     }
 
@@ -436,11 +823,7 @@ void zjs_destroy_emitter(jerry_value_t obj)
     // FIXME: probably better to more fully free in case JS keeps obj around
     ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
     if (handle) {
-        event_t *event = handle->events;
-        while (event) {
-            ZJS_LIST_FREE(listener_t, event->listeners, free_listener);
-            event = event->next;
-        }
+        free_listeners(handle);
     }
 }
 
@@ -475,6 +858,8 @@ static void zjs_event_init_prototype()
                                         &event_proto_type_info);
         jerry_release_value(zjs_event_emitter_prototype);
         emit_id = zjs_add_c_callback(NULL, emit_event_callback);
+        // deferred events mostly report I/O, so don't queue them behind timers
+        zjs_set_callback_priority(emit_id, ZJS_CALLBACK_PRIORITY_HIGH);
     }
 }
 
@@ -492,6 +877,9 @@ void zjs_make_emitter(jerry_value_t obj, jerry_value_t prototype,
     emitter_t *emitter = zjs_malloc(sizeof(emitter_t));
     emitter->max_listeners = DEFAULT_MAX_LISTENERS;
     emitter->events = NULL;
+    emitter->size = 0;
+    emitter->count = 0;
+    emitter->deferred = NULL;
     emitter->user_free = free_cb;
     emitter->user_handle = user_data;
     jerry_set_object_native_pointer(obj, emitter, &emitter_type_info);
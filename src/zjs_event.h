@@ -4,16 +4,40 @@
 #define __zjs_event_h__
 
 // ZJS includes
+#include "zjs_callbacks.h"
 #include "zjs_util.h"
 
 // enable to trace all callers of zjs_emit_event / zjs_defer_emit_event
 #define DEBUG_TRACE_EMIT 0
 
-// This needs to be big enough to fit all the args that any zjs_pre_emit
-// function wants to use, so may need to be increased in the future. An error
-// message in emit_event_callback should let you know that you've exceeded the
-// limit.
-#define MAX_EVENT_ARGS 2
+// Deferred events set up their args in an arena that is reused from one event
+// to the next. A zjs_pre_emit function always has room for this many args, or
+// for as many as there are jerry_value_t's in its buffer if that is more, so
+// any number of values can be passed through with zjs_copy_args.
+#define ZJS_EVENT_MIN_ARGS 4
+
+/**
+ * Interned event name
+ *
+ * Event names are interned into small integer atoms the first time a listener
+ * is added for them, and emitters index their listeners by atom. Native code
+ * that emits the same event often can resolve the atom once with
+ * zjs_event_intern() and emit with zjs_emit_event_id() to skip string hashing
+ * and comparison entirely. Atoms are never freed, and the same name always
+ * gives the same atom.
+ */
+typedef u16_t zjs_event_id;
+
+// never a valid atom
+#define ZJS_EVENT_NONE 0
+
+/**
+ * Token for a deferred event registered with zjs_register_deferred_event
+ */
+typedef zjs_callback_id zjs_event_token;
+
+// never a valid token
+#define ZJS_EVENT_TOKEN_NONE -1
 
 /**
  * Callback prototype for before an event is emitted
@@ -23,7 +47,7 @@
  * it must clean up after itself.
  *
  * @param handle  Event user handle provided to zjs_make_emitter
- * @param argv    Arg array w/ max of four args to be set up
+ * @param argv    Arg array to be set up, see ZJS_EVENT_MIN_ARGS for its size
  * @param argc    Pointer to arg count to be set (default 0)
  * @param buffer  Data provided to zjs_defer_emit_event from which to
  *                  construct arguments
@@ -38,7 +62,7 @@ typedef bool (*zjs_pre_emit)(void *handle, jerry_value_t argv[], u32_t *argc,
  * Callback prototype for after an event is emitted
  *
  * @param handle  Event user handle provided to zjs_make_emitter
- * @param argv    Arg array w/ max of four args to be cleaned up
+ * @param argv    Arg array to be cleaned up
  * @param argc    Arg count
  */
 typedef void (*zjs_post_emit)(void *handle, jerry_value_t argv[], u32_t argc);
@@ -101,6 +125,36 @@ void zjs_destroy_emitter(jerry_value_t obj);
  */
 void *zjs_event_get_user_handle(jerry_value_t obj);
 
+/**
+ * Get the atom for an event name, creating it if needed
+ *
+ * @param name  Event name
+ *
+ * @return      Atom for the name, or ZJS_EVENT_NONE if out of memory
+ */
+zjs_event_id zjs_event_intern(const char *name);
+
+/**
+ * Get the atom for an event name without creating it
+ *
+ * A name that has not been interned yet has never had a listener anywhere, so
+ * ZJS_EVENT_NONE also means there is nothing to emit to.
+ *
+ * @param name  Event name
+ *
+ * @return      Atom for the name, or ZJS_EVENT_NONE if not interned
+ */
+zjs_event_id zjs_event_lookup(const char *name);
+
+/**
+ * Get the name an atom was interned from
+ *
+ * @param id    Atom from zjs_event_intern
+ *
+ * @return      Event name, or NULL if id is not a valid atom
+ */
+const char *zjs_event_name(zjs_event_id id);
+
 /**
  * Add a new event listener to an event object.
  *
@@ -147,6 +201,60 @@ void zjs_defer_emit_event_priv(jerry_value_t obj, const char *name,
                                const void *buffer, int bytes,
                                zjs_pre_emit pre, zjs_post_emit post);
 
+/**
+ * Register an event that will be emitted from another thread or an ISR
+ *
+ * zjs_defer_emit_event has to copy the object, the event name, and the pre
+ * and post callbacks through the callback queue with every event. For sources
+ * that fire often, register the event once instead and emit it with
+ * zjs_defer_emit_token, which only queues the payload. The registration lasts
+ * until it is unregistered or the emitter is freed.
+ *
+ * @param obj     Event emitter object, held as a weak reference
+ * @param name    Name of event
+ * @param pre     Arg setup function called before event emitted, or NULL
+ * @param post    Arg teardown function called after event emitted, or NULL
+ *
+ * @return        Token for the event, or ZJS_EVENT_TOKEN_NONE on failure
+ */
+zjs_event_token zjs_register_deferred_event(jerry_value_t obj,
+                                            const char *name,
+                                            zjs_pre_emit pre,
+                                            zjs_post_emit post);
+
+/**
+ * Unregister a deferred event; any emits still queued for it are dropped
+ *
+ * @param obj     Event emitter object given to zjs_register_deferred_event
+ * @param token   Token from zjs_register_deferred_event
+ */
+void zjs_unregister_deferred_event(jerry_value_t obj, zjs_event_token token);
+
+/**
+ * zjs_defer_emit_token: Emit a registered event from a callback on the main
+ *   thread
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param token   Token from zjs_register_deferred_event
+ * @param buffer  Data needed to call event listeners
+ * @param bytes   Size of buffer
+ */
+#if DEBUG_TRACE_EMIT
+#define zjs_defer_emit_token(token, buffer, bytes)                          \
+    {                                                                       \
+        ZJS_PRINT("[EVENT] %s:%d Deferring token %d\n", __FILE__, __LINE__, \
+                  token);                                                   \
+        zjs_defer_emit_token_priv(token, buffer, bytes);                    \
+    }
+#else
+#define zjs_defer_emit_token zjs_defer_emit_token_priv
+#endif
+
+// NOTE: don't call the priv version directly
+void zjs_defer_emit_token_priv(zjs_event_token token, const void *buffer,
+                               u32_t bytes);
+
 /**
  * zjs_emit_event: Call any registered event listeners immediately
  *
@@ -171,6 +279,34 @@ void zjs_defer_emit_event_priv(jerry_value_t obj, const char *name,
 bool zjs_emit_event_priv(jerry_value_t obj, const char *name,
                          const jerry_value_t argv[], u32_t argc);
 
+/**
+ * zjs_emit_event_id: Call any registered event listeners immediately
+ *
+ * Like zjs_emit_event, but with an atom from zjs_event_intern instead of a
+ * name, for events emitted on hot paths.
+ *
+ * @param obj   Object that contains the event to be triggered
+ * @param id    Atom of event
+ * @param argv  Arguments to give to the event listeners as parameters
+ * @param argc  Number of arguments
+ *
+ * @return      True if there were listeners called
+ */
+#if DEBUG_TRACE_EMIT
+#define zjs_emit_event_id(obj, id, argv, argc)                          \
+    ({                                                                  \
+        ZJS_PRINT("[EVENT] %s:%d Emitting '%s'\n", __FILE__, __LINE__, \
+                  zjs_event_name(id));                                  \
+        zjs_emit_event_id_priv(obj, id, argv, argc);                    \
+    })
+#else
+#define zjs_emit_event_id zjs_emit_event_id_priv
+#endif
+
+// NOTE: don't call the priv version directly
+bool zjs_emit_event_id_priv(jerry_value_t obj, zjs_event_id id,
+                            const jerry_value_t argv[], u32_t argc);
+
 // emit helpers
 
 /**
@@ -181,6 +317,14 @@ bool zjs_emit_event_priv(jerry_value_t obj, const char *name,
 bool zjs_copy_arg(void *unused, jerry_value_t argv[], u32_t *argc,
                   const char *buffer, u32_t bytes);
 
+/**
+ * Copies all the jerry_value_t's in buffer to argv, in order
+ *
+ * A zjs_pre_emit callback.
+ */
+bool zjs_copy_args(void *unused, jerry_value_t argv[], u32_t *argc,
+                   const char *buffer, u32_t bytes);
+
 /**
  * Releases the jerry_value_t's in argv
  *
@@ -188,4 +332,12 @@ bool zjs_copy_arg(void *unused, jerry_value_t argv[], u32_t *argc,
  */
 void zjs_release_args(void *unused, jerry_value_t argv[], u32_t argc);
 
+/**
+ * Frees the args arena kept for deferred events
+ *
+ * Event listeners and deferred events are freed with their emitters, so this
+ * only has to be called once all modules have been cleaned up.
+ */
+void zjs_event_cleanup();
+
 #endif
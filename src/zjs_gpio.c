@@ -335,6 +335,8 @@ static ZJS_DECL_FUNC(zjs_gpio_open)
 
         // Register a C callback (will be called after the ISR is called)
         handle->callbackId = zjs_add_c_callback(handle, zjs_gpio_c_callback);
+        zjs_set_callback_priority(handle->callbackId,
+                                  ZJS_CALLBACK_PRIORITY_HIGH);
         handle->edge_both = (edge == ZJS_EDGE_BOTH) ? 1 : 0;
     }
 
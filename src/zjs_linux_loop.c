@@ -0,0 +1,101 @@
+// Copyright (c) 2018, Intel Corporation.
+
+/*
+ * Linux implementation of the main loop block/unblock primitives
+ *
+ * The main loop sleeps in epoll_wait() on two file descriptors: a timerfd that
+ * is armed for the next deadline the loop computed, and an eventfd that is
+ * poked by zjs_loop_unblock() whenever a callback is signaled. This replaces
+ * the semaphore used on Zephyr and keeps jslinux from spinning while idle.
+ */
+
+// C includes
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// ZJS includes
+#include "zjs_util.h"
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int event_fd = -1;
+
+static int add_fd(int fd)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void drain_fd(int fd)
+{
+    // both timerfd and eventfd deliver a single 8-byte counter
+    u64_t count;
+    while (read(fd, &count, sizeof(count)) == sizeof(count)) {
+    }
+}
+
+void zjs_loop_init(void)
+{
+    if (epoll_fd >= 0) {
+        return;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || timer_fd < 0 || event_fd < 0 || add_fd(timer_fd) ||
+        add_fd(event_fd)) {
+        ERR_PRINT("failed to create main loop fds (errno=%d)\n", errno);
+        // fall back to never blocking rather than blocking forever
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+            epoll_fd = -1;
+        }
+    }
+}
+
+// INTERRUPT SAFE FUNCTION: may be called from signal handlers and threads
+void zjs_loop_unblock(void)
+{
+    if (event_fd >= 0) {
+        u64_t one = 1;
+        // a full counter just means the loop is already due to wake up
+        ssize_t rval = write(event_fd, &one, sizeof(one));
+        (void)rval;
+    }
+}
+
+void zjs_loop_block(int time)
+{
+    // requires: time is in milliseconds, ZJS_TICKS_FOREVER to wait until
+    //             zjs_loop_unblock() is called
+    if (epoll_fd < 0 || time == ZJS_TICKS_NONE) {
+        return;
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (time != ZJS_TICKS_FOREVER) {
+        spec.it_value.tv_sec = time / 1000;
+        spec.it_value.tv_nsec = (time % 1000) * 1000000;
+    }
+    // an all-zero value disarms the timer when waiting forever
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+
+    struct epoll_event events[2];
+    int count;
+    do {
+        count = epoll_wait(epoll_fd, events, 2, -1);
+    } while (count < 0 && errno == EINTR);
+
+    for (int i = 0; i < count; i++) {
+        drain_fd(events[i].data.fd);
+    }
+}
@@ -1,9 +1,10 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef ZJS_LINUX_PORT_H_
 #define ZJS_LINUX_PORT_H_
 
 // C includes
+#include <errno.h>
 #include <stdint.h>
 #include <time.h>
 #include <unistd.h>
@@ -36,34 +37,25 @@ u8_t zjs_port_timer_test(zjs_port_timer_t *timer);
 
 u32_t zjs_port_timer_get_uptime(void);
 
+// free-running counter for measuring short intervals; wraps, so only use the
+// difference between two readings
+u32_t zjs_port_get_cycles(void);
+#define zjs_port_cycles_to_us(c) (c)
+
 #define ZJS_TICKS_NONE                 0
-#define ZJS_TICKS_FOREVER              0
+#define ZJS_TICKS_FOREVER              -1
 #define CONFIG_SYS_CLOCK_TICKS_PER_SEC 100
 #define zjs_sleep usleep
 
 #define SIZE32_OF(x) (sizeof((x)) / sizeof(u32_t))
 
-#define EAGAIN      11
-#define EMSGSIZE    12
-#define ENOSPC      28
-
-struct zjs_port_ring_buf {
-    u32_t head; /**< Index in buf for the head element */
-    u32_t tail; /**< Index in buf for the tail element */
-    u32_t size; /**< Size of buf in 32-bit chunks */
-    u32_t *buf; /**< Memory region for stored entries */
-    u32_t mask; /**< Modulo mask if size is a power of 2 */
-};
-
-void zjs_port_ring_buf_init(struct zjs_port_ring_buf *buf, u32_t size,
-                            u32_t *data);
-
-int zjs_port_ring_buf_get(struct zjs_port_ring_buf *buf, u16_t *type,
-                          u8_t *value, u32_t *data, u8_t *size32);
-
-// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
-int zjs_port_ring_buf_put(struct zjs_port_ring_buf *buf, u16_t type,
-                          u8_t value, u32_t *data, u8_t size32);
+// atomics used by lock-free code, matching Zephyr's atomic_t API
+typedef int zjs_port_atomic_t;
+#define zjs_port_atomic_get(t)        __atomic_load_n(t, __ATOMIC_SEQ_CST)
+#define zjs_port_atomic_set(t, v)     __atomic_exchange_n(t, v, __ATOMIC_SEQ_CST)
+#define zjs_port_atomic_cas(t, o, n)  __sync_bool_compare_and_swap(t, o, n)
+#define zjs_port_atomic_inc(t)        __atomic_fetch_add(t, 1, __ATOMIC_SEQ_CST)
+#define zjs_port_atomic_dec(t)        __atomic_fetch_sub(t, 1, __ATOMIC_SEQ_CST)
 
 #define zjs_port_get_thread_id() 0
 
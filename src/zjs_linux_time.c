@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // C includes
 #include <time.h>
@@ -46,3 +46,13 @@ u32_t zjs_port_timer_get_uptime(void)
 
     return (1000 * now.tv_sec) + (now.tv_nsec / 1000000);
 }
+
+u32_t zjs_port_get_cycles(void)
+{
+    // the Linux "cycle" counter just runs in microseconds
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (1000000 * now.tv_sec) + (now.tv_nsec / 1000);
+}
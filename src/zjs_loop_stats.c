@@ -0,0 +1,118 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifdef ZJS_LOOP_STATS
+// C includes
+#include <string.h>
+
+// ZJS includes
+#include "zjs_callbacks.h"
+#include "zjs_loop_stats.h"
+
+static zjs_loop_stats_t loop_stats = { .lag_min_us = 0xffffffff };
+static u32_t last_mark = 0;     // cycles at the end of the last phase
+static u32_t wake_cycles = 0;   // cycles when the iteration started
+static u32_t sleep_uptime = 0;  // uptime (ms) when the loop went to sleep
+static bool asleep = false;
+
+int zjs_log2_bucket(u32_t value, int buckets)
+{
+    int bucket = 0;
+    for (u32_t rest = value >> 1; rest && bucket < buckets - 1; rest >>= 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+static void charge(zjs_loop_phase_t phase, u32_t now)
+{
+    loop_stats.time_us[phase] += zjs_port_cycles_to_us(now - last_mark);
+    last_mark = now;
+}
+
+void zjs_loop_stats_wake(void)
+{
+    u32_t now = zjs_port_get_cycles();
+    if (asleep) {
+        // the cycle counter may wrap during a long sleep, so fall back to the
+        //   coarser uptime clock for those
+        u32_t slept_ms = zjs_port_timer_get_uptime() - sleep_uptime;
+        if (slept_ms > 1000) {
+            loop_stats.time_us[ZJS_LOOP_IDLE] += (u64_t)slept_ms * 1000;
+            last_mark = now;
+        } else {
+            charge(ZJS_LOOP_IDLE, now);
+        }
+        asleep = false;
+    } else {
+        last_mark = now;
+    }
+    wake_cycles = now;
+
+    zjs_callback_stats_t cb_stats;
+    zjs_get_callback_stats(&cb_stats);
+    if (cb_stats.pending > loop_stats.queue_max) {
+        loop_stats.queue_max = cb_stats.pending;
+    }
+    loop_stats.queue_sum += cb_stats.pending;
+}
+
+void zjs_loop_stats_mark(zjs_loop_phase_t phase)
+{
+    charge(phase, zjs_port_get_cycles());
+}
+
+void zjs_loop_stats_sleep(void)
+{
+    u32_t now = zjs_port_get_cycles();
+    charge(ZJS_LOOP_OTHER, now);
+
+    u32_t lag = zjs_port_cycles_to_us(now - wake_cycles);
+    loop_stats.lag_hist[zjs_log2_bucket(lag, ZJS_LOOP_LAG_BUCKETS)]++;
+    loop_stats.lag_sum_us += lag;
+    if (lag < loop_stats.lag_min_us) {
+        loop_stats.lag_min_us = lag;
+    }
+    if (lag > loop_stats.lag_max_us) {
+        loop_stats.lag_max_us = lag;
+    }
+    loop_stats.iterations++;
+
+    sleep_uptime = zjs_port_timer_get_uptime();
+    asleep = true;
+}
+
+void zjs_get_loop_stats(zjs_loop_stats_t *stats)
+{
+    *stats = loop_stats;
+    if (!stats->iterations) {
+        stats->lag_min_us = 0;
+    }
+}
+
+void zjs_reset_loop_lag(void)
+{
+    loop_stats.iterations = 0;
+    loop_stats.lag_min_us = 0xffffffff;
+    loop_stats.lag_max_us = 0;
+    loop_stats.lag_sum_us = 0;
+    memset(loop_stats.lag_hist, 0, sizeof(loop_stats.lag_hist));
+    loop_stats.queue_max = 0;
+    loop_stats.queue_sum = 0;
+}
+
+u32_t zjs_loop_lag_percentile(const zjs_loop_stats_t *stats,
+                              double percentile)
+{
+    // requires: stats->iterations counts the entries in stats->lag_hist
+    double target = stats->iterations * percentile / 100;
+    u32_t seen = 0;
+    for (int i = 0; i < ZJS_LOOP_LAG_BUCKETS - 1; i++) {
+        seen += stats->lag_hist[i];
+        if (seen && seen >= target) {
+            u32_t bound = ((u32_t)1 << (i + 1)) - 1;
+            return (bound < stats->lag_max_us) ? bound : stats->lag_max_us;
+        }
+    }
+    return stats->lag_max_us;
+}
+#endif  // ZJS_LOOP_STATS
@@ -0,0 +1,106 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_loop_stats_h__
+#define __zjs_loop_stats_h__
+
+/*
+ * Main loop instrumentation
+ *
+ * The main loop marks the end of each of its phases; the time since the
+ * previous mark is charged to that phase. The time spent in each iteration
+ * between waking up and going back to sleep is the loop lag, the longest any
+ * event arriving during that iteration could have waited, and is recorded in a
+ * log2 histogram. Everything is fixed size and costs a cycle counter read per
+ * mark, so it stays on by default; build with LOOP_STATS=off to compile it out.
+ */
+
+// ZJS includes
+#include "zjs_util.h"
+
+typedef enum zjs_loop_phase {
+    ZJS_LOOP_CALLBACKS,
+    ZJS_LOOP_TIMERS,
+    ZJS_LOOP_ROUTINES,
+    ZJS_LOOP_IMMEDIATES,
+    ZJS_LOOP_JOBS,
+    ZJS_LOOP_OTHER,
+    ZJS_LOOP_IDLE,
+    ZJS_LOOP_PHASES
+} zjs_loop_phase_t;
+
+// bucket i counts lags of [2^i, 2^(i+1)) us, bucket 0 also counts 0 us
+#define ZJS_LOOP_LAG_BUCKETS 24
+
+typedef struct zjs_loop_stats {
+    u64_t time_us[ZJS_LOOP_PHASES];   // total time spent in each phase
+    u32_t iterations;
+    u32_t lag_min_us;
+    u32_t lag_max_us;
+    u64_t lag_sum_us;
+    u32_t lag_hist[ZJS_LOOP_LAG_BUCKETS];
+    u32_t queue_max;                  // most callback bytes pending at wake
+    u64_t queue_sum;
+} zjs_loop_stats_t;
+
+#ifdef ZJS_LOOP_STATS
+/**
+ * Find the log2 histogram bucket for a value
+ *
+ * @param value         Value to place
+ * @param buckets       Number of buckets, the last one also counts larger values
+ *
+ * @return              Bucket i for values of [2^i, 2^(i+1)), 0 for 0 and 1
+ */
+int zjs_log2_bucket(u32_t value, int buckets);
+
+/**
+ * Mark the main loop waking up, charging the time asleep as idle
+ */
+void zjs_loop_stats_wake(void);
+
+/**
+ * Charge the time since the last mark to a phase
+ *
+ * @param phase         Phase that just finished
+ */
+void zjs_loop_stats_mark(zjs_loop_phase_t phase);
+
+/**
+ * Mark the main loop going to sleep, ending the iteration
+ */
+void zjs_loop_stats_sleep(void);
+
+/**
+ * Get a copy of the counters
+ *
+ * @param stats         Receives the counters
+ */
+void zjs_get_loop_stats(zjs_loop_stats_t *stats);
+
+/**
+ * Clear the lag histogram and queue depth counters, but not phase times
+ */
+void zjs_reset_loop_lag(void);
+
+/**
+ * Find the lag below which a given share of iterations fell
+ *
+ * @param stats         Counters from zjs_get_loop_stats
+ * @param percentile    Share of iterations, 0 to 100
+ *
+ * @return              Upper bound of the matching bucket in microseconds,
+ *                        capped by the largest lag seen
+ */
+u32_t zjs_loop_lag_percentile(const zjs_loop_stats_t *stats,
+                              double percentile);
+
+#define ZJS_LOOP_STATS_WAKE()         zjs_loop_stats_wake()
+#define ZJS_LOOP_STATS_MARK(phase)    zjs_loop_stats_mark(phase)
+#define ZJS_LOOP_STATS_SLEEP()        zjs_loop_stats_sleep()
+#else
+#define ZJS_LOOP_STATS_WAKE()         do {} while (0)
+#define ZJS_LOOP_STATS_MARK(phase)    do {} while (0)
+#define ZJS_LOOP_STATS_SLEEP()        do {} while (0)
+#endif
+
+#endif  // __zjs_loop_stats_h__
@@ -1,6 +1,7 @@
 // Copyright (c) 2016-2018, Intel Corporation.
 
 // C includes
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -17,7 +18,11 @@
 #include "zjs_linux_port.h"
 #endif
 
+#include "zjs_bundle.h"
 #include "zjs_callbacks.h"
+#if defined(BUILD_MODULE_EVENT) || defined(BUILD_MODULE_EVENTS)
+#include "zjs_event.h"
+#endif
 #include "zjs_modules.h"
 #include "zjs_modules_gen.h"
 #include "zjs_script.h"
@@ -28,17 +33,45 @@
 #include "zjs_file_utils.h"
 #endif
 
-struct routine_map {
-    zjs_service_routine func;
+struct zjs_routine {
+    zjs_service_routine func;  // NULL once unregistered
     void *handle;
+    u32_t due;                 // uptime (ms) when the routine runs again
+    bool scheduled;            // false while waiting only to be woken
+    zjs_port_atomic_t woken;
+    struct zjs_routine *next;
 };
 
 #ifdef ZJS_DYNAMIC_LOAD
 static char *load_file;
 #endif // ZJS_DYNAMIC_LOAD
 
-static u8_t num_routines = 0;
-struct routine_map svc_routine_map[NUM_SERVICE_ROUTINES];
+// modules resolved so far by name, exposed to JS as require.cache
+static jerry_value_t require_cache = 0;
+static zjs_require_stats_t require_stats = { 0 };
+
+static zjs_routine_t *routines = NULL;
+
+#define GBL_MODCOUNT (int)(sizeof(zjs_global_array) / sizeof(gbl_module_t))
+
+// global modules whose init has run since the last zjs_modules_init; one
+//   spare keeps the array valid when no global modules are built
+static bool gbl_ready[GBL_MODCOUNT + 1];
+// global modules whose lazy accessor is still installed
+static bool gbl_deferred[GBL_MODCOUNT + 1];
+
+typedef struct init_record {
+    const char *name;
+    u32_t time_us;
+    s32_t heap_bytes;   // heap growth during init, if has_heap
+    bool has_heap;      // JerryScript was built with memory stats
+    bool lazy;          // ran on first access instead of at startup
+} init_record_t;
+
+// one for each global module, plus error and timers
+#define MAX_INIT_RECORDS (GBL_MODCOUNT + 2)
+static init_record_t init_records[MAX_INIT_RECORDS];
+static int init_count = 0;
 
 /*****************************************************************
 *   Real board JavaScript module resolver (ASHELL only currently)
@@ -163,6 +196,29 @@ static bool load_js_module_obj(const jerry_value_t module_name,
     return true;
 }
 
+// Run the module from the snapshot bundle, if it was bundled
+static bool load_js_module_bundle(const jerry_value_t module_name,
+                                  jerry_value_t *result)
+{
+    jerry_size_t module_size = jerry_get_utf8_string_size(module_name) + 1;
+    char module[module_size];
+    zjs_copy_jstring(module_name, module, &module_size);
+
+    const zjs_bundle_entry_t *entry = zjs_bundle_find(module);
+    if (!entry) {
+        return false;
+    }
+
+    ZVAL ret = zjs_bundle_run(entry);
+    if (jerry_value_is_error(ret)) {
+        ERR_PRINT("failed to evaluate JS\n");
+        return false;
+    }
+
+    // bundled modules export themselves the same way inlined ones do
+    return load_js_module_obj(module_name, result);
+}
+
 /****************************
 *   Jerry module resolvers
 *****************************/
@@ -178,11 +234,18 @@ static jerryx_module_resolver_t load_js_resolver =
     load_js_module_obj
 };
 
+static jerryx_module_resolver_t load_bundle_resolver =
+{
+    NULL,
+    load_js_module_bundle
+};
+
 // These execute in order until a matching module is found
 static const jerryx_module_resolver_t *resolvers[] =
 {
     &jerryx_module_native_resolver,  // Check for a native module
     &load_js_resolver,               // Check for a JS module in the code
+    &load_bundle_resolver,           // Check for a JS module in the bundle
     &load_fs_resolver                // Check for a JS module on the FS
 };
 
@@ -200,17 +263,36 @@ static ZJS_DECL_FUNC(native_require_handler)
     char module[module_size];
     zjs_copy_jstring(argv[0], module, &module_size);
 
+    // as in Node.js, each module is loaded once and shared by every caller;
+    //   deleting it from require.cache makes the next call load it again
+    ZVAL cached = jerry_has_own_property(require_cache, argv[0]);
+    if (jerry_get_boolean_value(cached)) {
+        require_stats.hits++;
+        return jerry_get_property(require_cache, argv[0]);
+    }
+    require_stats.misses++;
+
     // Try each of the resolvers to see if we can find the requested module
-    jerry_value_t result = jerryx_module_resolve(argv[0], resolvers, 3);
+    jerry_value_t result = jerryx_module_resolve(argv[0], resolvers,
+                                                 sizeof(resolvers) /
+                                                 sizeof(resolvers[0]));
     if (jerry_value_is_error(result)) {
         DBG_PRINT("Couldn't load module %s\n", module);
+        // failures aren't cached, so a later call tries again
+        jerry_release_value(result);
         return NOTSUPPORTED_ERROR("Module not found");
     } else {
         DBG_PRINT("Module %s loaded\n", module);
     }
+    jerry_set_property(require_cache, argv[0], result);
     return result;
 }
 
+void zjs_get_require_stats(zjs_require_stats_t *stats)
+{
+    *stats = require_stats;
+}
+
 // native eval handler
 static ZJS_DECL_FUNC(native_eval_handler)
 {
@@ -316,6 +398,139 @@ static ZJS_DECL_FUNC(zjs_run_js)
 }
 #endif  // ZJS_DYNAMIC_LOAD
 
+static void profile_init(const char *name, void (*init)(), bool lazy)
+{
+    // effects: calls init, recording its time and heap use for the startup
+    //            profile
+    jerry_heap_stats_t before = { 0 }, after = { 0 };
+    bool has_stats = jerry_get_memory_stats(&before);
+    u32_t start = zjs_port_get_cycles();
+    init();
+    u32_t time_us = zjs_port_cycles_to_us(zjs_port_get_cycles() - start);
+    has_stats = has_stats && jerry_get_memory_stats(&after);
+
+    if (init_count < MAX_INIT_RECORDS) {
+        init_record_t *record = &init_records[init_count++];
+        record->name = name;
+        record->time_us = time_us;
+        record->heap_bytes = (s32_t)(after.allocated_bytes -
+                                     before.allocated_bytes);
+        record->has_heap = has_stats;
+        record->lazy = lazy;
+    }
+}
+
+static void init_global_module(gbl_module_t *mod, bool lazy)
+{
+    int index = mod - zjs_global_array;
+    if (!gbl_ready[index]) {
+        gbl_ready[index] = true;
+        profile_init(mod->name, mod->init, lazy);
+    }
+}
+
+static gbl_module_t *lazy_global_module(jerry_value_t func)
+{
+    // requires: func is one of the accessor functions from add_lazy_global
+    //  effects: returns the module it was installed for
+    gbl_module_t *mod = NULL;
+    const jerry_object_native_info_t *tmp;
+    jerry_get_object_native_pointer(func, (void **)&mod, &tmp);
+    return mod;
+}
+
+static bool take_lazy_global(gbl_module_t *mod)
+{
+    // effects: removes mod's accessor from the global object; returns false
+    //            if it was already replaced, since the accessor functions
+    //            stay reachable through Object.getOwnPropertyDescriptor
+    int index = mod - zjs_global_array;
+    if (!gbl_deferred[index]) {
+        return false;
+    }
+    gbl_deferred[index] = false;
+
+    ZVAL global_obj = jerry_get_global_object();
+    zjs_delete_property(global_obj, mod->global);
+    return true;
+}
+
+static ZJS_DECL_FUNC(lazy_global_get)
+{
+    // the init installs the real value in place of the accessor
+    gbl_module_t *mod = lazy_global_module(function_obj);
+    if (take_lazy_global(mod)) {
+        init_global_module(mod, true);
+    }
+
+    ZVAL global_obj = jerry_get_global_object();
+    return zjs_get_property(global_obj, mod->global);
+}
+
+static ZJS_DECL_FUNC(lazy_global_set)
+{
+    // the script replaced the global before ever reading it, so the module
+    //   never needs to be built; a saved setter does nothing after that
+    gbl_module_t *mod = lazy_global_module(function_obj);
+    if (take_lazy_global(mod)) {
+        ZVAL global_obj = jerry_get_global_object();
+        zjs_set_property(global_obj, mod->global,
+                         argc > 0 ? argv[0] : ZJS_UNDEFINED);
+    }
+    return ZJS_UNDEFINED;
+}
+
+static void add_lazy_global(jerry_value_t global_obj, gbl_module_t *mod)
+{
+    // effects: installs mod's global as a configurable accessor that runs the
+    //            module's init the first time it is read
+    jerry_property_descriptor_t desc;
+    jerry_init_property_descriptor_fields(&desc);
+    desc.is_get_defined = true;
+    desc.getter = jerry_create_external_function(lazy_global_get);
+    desc.is_set_defined = true;
+    desc.setter = jerry_create_external_function(lazy_global_set);
+    desc.is_configurable_defined = true;
+    desc.is_configurable = true;
+    desc.is_enumerable_defined = true;
+    desc.is_enumerable = true;
+    jerry_set_object_native_pointer(desc.getter, mod, NULL);
+    jerry_set_object_native_pointer(desc.setter, mod, NULL);
+
+    ZVAL name = jerry_create_string((const jerry_char_t *)mod->global);
+    ZVAL result = jerry_define_own_property(global_obj, name, &desc);
+    if (jerry_value_is_error(result)) {
+        // fall back to building it now
+        init_global_module(mod, false);
+    } else {
+        gbl_deferred[mod - zjs_global_array] = true;
+    }
+    jerry_free_property_descriptor_fields(&desc);
+}
+
+void zjs_print_startup_profile()
+{
+    ZJS_PRINT("\n--------------- Startup Profile ---------------\n");
+    ZJS_PRINT("%-12s %-10s %10s %10s\n", "module", "init", "time (us)",
+              "heap");
+    for (int i = 0; i < init_count; i++) {
+        init_record_t *record = &init_records[i];
+        char heap[12] = "n/a";
+        if (record->has_heap) {
+            snprintf(heap, sizeof(heap), "%d", (int)record->heap_bytes);
+        }
+        ZJS_PRINT("%-12s %-10s %10u %10s\n", record->name,
+                  record->lazy ? "first use" : "startup",
+                  (unsigned int)record->time_us, heap);
+    }
+    for (int i = 0; i < GBL_MODCOUNT; i++) {
+        if (!gbl_ready[i]) {
+            ZJS_PRINT("%-12s %s\n", zjs_global_array[i].name, "never");
+        }
+    }
+    ZJS_PRINT("-------------------- End --------------------\n");
+}
+
 void zjs_modules_init()
 {
     // Add module.exports to global namespace
@@ -336,25 +551,37 @@ void zjs_modules_init()
 #endif // ZJS_DYNAMIC_LOAD
 
     // create the C handler for require JS call
-    zjs_obj_add_function(global_obj, "require", native_require_handler);
+    ZVAL require = jerry_create_external_function(native_require_handler);
+    require_cache = zjs_create_object();
+    zjs_set_property(require, "cache", require_cache);
+    zjs_set_property(global_obj, "require", require);
 
-#ifdef ZJS_LINUX_BUILD
+    // process.nextTick is added along with the timers
     ZVAL process = zjs_create_object();
+#ifdef ZJS_LINUX_BUILD
     zjs_obj_add_function(process, "exit", process_exit);
-    zjs_set_property(global_obj, "process", process);
 #endif
+    zjs_set_property(global_obj, "process", process);
 
     // initialize callbacks early in case any init functions use them
     zjs_init_callbacks();
-    // Load global modules
-    int gbl_modcount = sizeof(zjs_global_array) / sizeof(gbl_module_t);
-    for (int i = 0; i < gbl_modcount; i++) {
+    // Load global modules, deferring the ones that install a known global
+    //   until the script first reads it
+    init_count = 0;
+    for (int i = 0; i < GBL_MODCOUNT; i++) {
         gbl_module_t *mod = &zjs_global_array[i];
-        mod->init();
+        gbl_ready[i] = false;
+        gbl_deferred[i] = false;
+        if (mod->global) {
+            add_lazy_global(global_obj, mod);
+        } else {
+            init_global_module(mod, false);
+        }
     }
-    // initialize fixed modules
-    zjs_error_init();
-    zjs_timers_init();
+    // initialize fixed modules; C code throws with the error constructors and
+    //   timers back process.nextTick, so these stay eager
+    profile_init("error", zjs_error_init, false);
+    profile_init("timers", zjs_timers_init, false);
 }
 
 void zjs_modules_cleanup()
@@ -362,8 +589,9 @@ void zjs_modules_cleanup()
     // stop timers first to prevent further calls
     zjs_timers_cleanup();
 
-    int gbl_modcount = sizeof(zjs_global_array) / sizeof(gbl_module_t);
-    for (int i = 0; i < gbl_modcount; i++) {
+    // cleanups also run for lazy modules that were never initialized, so
+    //   state C code created without the global gets released too
+    for (int i = 0; i < GBL_MODCOUNT; i++) {
         gbl_module_t *mod = &zjs_global_array[i];
         if (mod->cleanup) {
             mod->cleanup();
@@ -371,48 +599,103 @@ void zjs_modules_cleanup()
     }
     // clean up fixed modules
     zjs_error_cleanup();
+#if defined(BUILD_MODULE_EVENT) || defined(BUILD_MODULE_EVENTS)
+    // last, since module cleanups may still emit events
+    zjs_event_cleanup();
+#endif
+
+    jerry_release_value(require_cache);
+    require_cache = 0;
+    require_stats = (zjs_require_stats_t){ 0 };
+
+    // drop routines of modules that never unregistered them; the structs
+    //   stay in the list for reuse
+    for (zjs_routine_t *routine = routines; routine; routine = routine->next) {
+        routine->func = NULL;
+    }
 
 #ifdef ZJS_TRACE_MALLOC
     zjs_print_mem_stats();
 #endif
 }
 
-void zjs_register_service_routine(void *handle, zjs_service_routine func)
+zjs_routine_t *zjs_register_service_routine(void *handle,
+                                            zjs_service_routine func)
 {
-    if (num_routines >= NUM_SERVICE_ROUTINES) {
-        DBG_PRINT(("not enough space, increase NUM_SERVICE_ROUTINES\n"));
-        return;
+    // routines are never freed, since another thread may still wake one after
+    //   it was unregistered; reusing the struct only costs a spurious run
+    zjs_routine_t *routine = routines;
+    while (routine && routine->func) {
+        routine = routine->next;
+    }
+    if (!routine) {
+        routine = zjs_malloc(sizeof(zjs_routine_t));
+        if (!routine) {
+            ERR_PRINT("out of memory registering service routine\n");
+            return NULL;
+        }
+        routine->next = NULL;
+        ZJS_LIST_APPEND(zjs_routine_t, routines, routine);
     }
-    svc_routine_map[num_routines].handle = handle;
-    svc_routine_map[num_routines].func = func;
-    num_routines++;
-    return;
+    routine->handle = handle;
+    routine->due = zjs_port_timer_get_uptime();
+    routine->scheduled = true;
+    zjs_port_atomic_set(&routine->woken, 0);
+    routine->func = func;
+    return routine;
 }
 
 void zjs_unregister_service_routine(zjs_service_routine func)
 {
-    for (int i = 0; i < num_routines; i++) {
-        if (svc_routine_map[i].func == func) {
-            svc_routine_map[i].handle = NULL;
-            num_routines--;
+    zjs_routine_t *routine = routines;
+    while (routine) {
+        if (routine->func == func) {
+            // another thread may be about to wake it, so keep the struct for
+            //   the next registration rather than freeing it
+            routine->func = NULL;
             return;
         }
+        routine = routine->next;
     }
     ERR_PRINT("Couldn't unregister routine for %p\n", func);
 }
 
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+void zjs_wake_service_routine(zjs_routine_t *routine)
+{
+    if (routine) {
+        zjs_port_atomic_set(&routine->woken, 1);
+        zjs_loop_unblock();
+    }
+}
+
 s32_t zjs_service_routines(void)
 {
     s32_t wait = ZJS_TICKS_FOREVER;
-    int i;
-    for (i = 0; i < num_routines; ++i) {
-        s32_t ret = svc_routine_map[i].func(svc_routine_map[i].handle);
-        wait = (wait < ret) ? wait : ret;
-    }
-#ifdef ZJS_LINUX_BUILD
-    if (wait == ZJS_TICKS_FOREVER) {
-        return 0;
+    for (zjs_routine_t *routine = routines; routine; routine = routine->next) {
+        if (!routine->func) {
+            continue;
+        }
+        u32_t now = zjs_port_timer_get_uptime();
+        bool woken = zjs_port_atomic_cas(&routine->woken, 1, 0);
+        if (woken ||
+            (routine->scheduled && (s32_t)(now - routine->due) >= 0)) {
+            s32_t next = routine->func(routine->handle);
+            now = zjs_port_timer_get_uptime();
+            routine->scheduled = next != ZJS_TICKS_FOREVER;
+            routine->due = now + ((next > 0) ? next : 0);
+        }
+
+        // the routine may have unregistered itself
+        if (routine->func && routine->scheduled) {
+            s32_t left = (s32_t)(routine->due - now);
+            if (left < 0) {
+                left = 0;
+            }
+            if (wait == ZJS_TICKS_FOREVER || left < wait) {
+                wait = left;
+            }
+        }
     }
-#endif
     return wait;
 }
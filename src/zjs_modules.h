@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef __zjs_modules_h__
 #define __zjs_modules_h__
@@ -9,7 +9,6 @@
 
 #include "jerryscript.h"
 
-#define NUM_SERVICE_ROUTINES 3
 #define MAX_MODULE_STR_LEN 32
 
 /**
@@ -17,14 +16,81 @@
  *
  * @param handle        Handle that was registered
  *
- * @return              Time until next event, ZJS_TICKS_FOREVER if unknown
+ * @return              Time (ms) until the routine is due again,
+ *                        ZJS_TICKS_NONE to run on the next pass, or
+ *                        ZJS_TICKS_FOREVER to wait until woken
  */
 typedef s32_t (*zjs_service_routine)(void *handle);
 
+typedef struct zjs_routine zjs_routine_t;
+
 void zjs_modules_init();
 void zjs_modules_cleanup();
-void zjs_register_service_routine(void *handle, zjs_service_routine func);
+
+typedef struct zjs_require_stats {
+    u32_t hits;     // require() calls answered from require.cache
+    u32_t misses;   // require() calls that had to resolve the module
+} zjs_require_stats_t;
+
+/**
+ * Get a copy of the require() cache counters
+ *
+ * @param stats         Receives the counters
+ */
+void zjs_get_require_stats(zjs_require_stats_t *stats);
+
+/**
+ * Print the time and heap each global module took to initialize
+ *
+ * Modules that install a global are only initialized when the script first
+ * reads it, so the profile also lists the ones that were never needed. Heap
+ * use shows as n/a unless JerryScript was built with memory stats.
+ */
+void zjs_print_startup_profile();
+
+/**
+ * Register a routine to be called from the main loop
+ *
+ * The routine is first called on the next pass, and after that only when the
+ * time it returned has passed or it is woken.
+ *
+ * @param handle        Handle passed back to the routine
+ * @param func          Routine to call
+ *
+ * @return              Registered routine to pass to zjs_wake_service_routine,
+ *                        or NULL if out of memory
+ */
+zjs_routine_t *zjs_register_service_routine(void *handle,
+                                            zjs_service_routine func);
+
+/**
+ * Stop calling a routine
+ *
+ * The routine struct is never freed but kept for a later registration, so a
+ * thread that read the pointer before the module cleared it can still wake it;
+ * at worst the routine registered next runs one extra time.
+ *
+ * @param func          Routine that was registered
+ */
 void zjs_unregister_service_routine(zjs_service_routine func);
+
+/**
+ * Make a routine run on the next pass of the main loop, whatever its deadline
+ *
+ * INTERRUPT SAFE FUNCTION: may be called from ISRs and other threads. To stop
+ * waking a routine that is being unregistered, the module must clear its
+ * pointer to it before calling zjs_unregister_service_routine.
+ *
+ * @param routine       Routine returned by zjs_register_service_routine
+ */
+void zjs_wake_service_routine(zjs_routine_t *routine);
+
+/**
+ * Call the registered routines that are due or have been woken
+ *
+ * @return              Time (ms) until the next routine is due,
+ *                        ZJS_TICKS_FOREVER if none is scheduled
+ */
 s32_t zjs_service_routines(void);
 void zjs_stop_js();
 
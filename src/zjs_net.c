@@ -101,6 +101,8 @@ static char FTRACE_PREFIX[] = "net";
 
 #define MAX_DBG_PRINT 64
 static jerry_value_t zjs_net_prototype;
+// resolved once, every received packet emits it
+static zjs_event_id data_event = ZJS_EVENT_NONE;
 static jerry_value_t zjs_net_socket_prototype;
 static jerry_value_t zjs_net_server_prototype;
 
@@ -129,13 +131,13 @@ typedef struct sock_handle {
     struct net_context *tcp_sock;
     struct sockaddr remote;
     jerry_value_t socket;
-    void *rptr;
-    void *wptr;
+    u8_t *rptr;
+    u8_t *wptr;
     struct k_timer timer;
     u32_t timeout;
     u8_t bound;
     u8_t paused;
-    u8_t *rbuf;
+    zjs_buffer_store_t *rstore;
     u8_t timer_started;
     u8_t closing;
     u8_t closed;
@@ -338,7 +340,7 @@ static void release_close(void *handle, jerry_value_t argv[], u32_t argc)
             zjs_destroy_emitter(h->socket);
             jerry_release_value(h->socket);
             // FIXME: this part should maybe move into an emitter free cb
-            zjs_free(h->rbuf);
+            zjs_buffer_store_release(h->rstore);
             zjs_free(h);
         }
 
@@ -457,27 +459,33 @@ static void receive_packet(const void *buffer, u32_t length)
             DBG_PRINT("received data, context=%p, data=%p, len=%u\n",
                       receive->context, data, len);
 
+            if (!zjs_buffer_store_reserve(&handle->rstore, &handle->rptr,
+                                          &handle->wptr, len)) {
+                DBG_PRINT("out of memory\n");
+                net_pkt_unref(pkt);
+                return;
+            }
             memcpy(handle->wptr, data, len);
             handle->wptr += len;
 
             // if not paused, call the callback to get JS the data
             if (!handle->paused) {
-                // find length of unconsumed data in read buffer
+                // hand JS a view of the unconsumed data in the read buffer
                 u32_t len = handle->wptr - handle->rptr;
                 zjs_buffer_t *zbuf;
-                ZVAL data_buf = zjs_buffer_create(len, &zbuf);
+                ZVAL data_buf = zjs_buffer_create_view(handle->rstore,
+                                                       handle->rptr -
+                                                       handle->rstore->data,
+                                                       len, &zbuf);
                 if (!zbuf) {
                     // out of memory
                     DBG_PRINT("out of memory\n");
                     net_pkt_unref(pkt);
                     return;
                 }
+                handle->rptr = handle->wptr;
 
-                // copy data from read buffer
-                memcpy(zbuf->buffer, handle->rptr, len);
-                handle->rptr = handle->wptr = handle->rbuf;
-
-                zjs_emit_event(handle->socket, "data", &data_buf, 1);
+                zjs_emit_event_id(handle->socket, data_event, &data_buf, 1);
             }
         }
     }
@@ -588,7 +596,7 @@ static void tcp_received(struct net_context *context,
     receive.handle = handle;
     receive.pkt = pkt;
 
-    zjs_defer_work(receive_packet, &receive, sizeof(receive));
+    zjs_defer_io_work(receive_packet, &receive, sizeof(receive));
 }
 
 static inline void pkt_sent(struct net_context *context, int status,
@@ -782,8 +790,8 @@ static jerry_value_t create_socket(u8_t client, sock_handle_t **handle_out)
     }
     memset(sock_handle, 0, sizeof(sock_handle_t));
 
-    sock_handle->rbuf = zjs_malloc(SOCK_READ_BUF_SIZE);
-    if (!sock_handle->rbuf) {
+    sock_handle->rstore = zjs_buffer_store_alloc(SOCK_READ_BUF_SIZE);
+    if (!sock_handle->rstore) {
         zjs_free(sock_handle);
         return ZJS_UNDEFINED;
     }
@@ -799,7 +807,7 @@ static jerry_value_t create_socket(u8_t client, sock_handle_t **handle_out)
 
     sock_handle->connect_listener = ZJS_UNDEFINED;
     sock_handle->socket = jerry_acquire_value(socket);
-    sock_handle->rptr = sock_handle->wptr = sock_handle->rbuf;
+    sock_handle->rptr = sock_handle->wptr = sock_handle->rstore->data;
 
     zjs_make_emitter(socket, zjs_net_socket_prototype, sock_handle, NULL);
 
@@ -934,7 +942,7 @@ static void tcp_accepted(struct net_context *context,
     memset(&accept.addr, 0, sizeof(struct sockaddr));
     zjs_copy_sockaddr(&accept.addr, addr, addrlen);
 
-    zjs_defer_work(accept_connection, &accept, sizeof(accept));
+    zjs_defer_io_work(accept_connection, &accept, sizeof(accept));
 }
 
 /**
@@ -1474,6 +1482,7 @@ static jerry_value_t zjs_net_init()
     zjs_net_config_default();
 
     k_mutex_init(&socket_mutex);
+    data_event = zjs_event_intern("data");
 
     zjs_native_func_t net_array[] = {
             { net_create_server, "createServer" },
@@ -14,6 +14,7 @@
 
 // ZJS includes
 #include "zjs_common.h"
+#include "zjs_modules.h"
 #include "zjs_util.h"
 
 #include "zjs_net_config.h"
@@ -255,15 +256,17 @@ jerry_value_t zjs_ocf_decode_value(oc_rep_t *data)
 }
 
 jerry_value_t ocf_object;
+// read by the network thread, so cleanup clears it before unregistering
+static zjs_routine_t *volatile ocf_routine = NULL;
 
 /*
  * Must be defined for iotivity-constrained
  */
 void oc_signal_main_loop(void)
 {
-#ifndef ZJS_LINUX_BUILD
-    zjs_loop_unblock();
-#endif
+    // may be called from the network thread, even during cleanup; a cleared
+    //   routine is ignored, and routine structs are never freed
+    zjs_wake_service_routine(ocf_routine);
 }
 
 #ifdef OC_CLIENT
@@ -478,9 +481,19 @@ static int app_init(void)
     return ret;
 }
 
-s32_t main_poll_routine(void *handle)
+// Routine to call into iotivity-constrained, returns time (ms) until next event
+static s32_t main_poll_routine(void *handle)
 {
-    return (s32_t)oc_main_poll();
+    // oc_main_poll returns the absolute time of the next event, or 0 if none
+    oc_clock_time_t next = oc_main_poll();
+    if (next == 0) {
+        return ZJS_TICKS_FOREVER;
+    }
+    oc_clock_time_t now = oc_clock_time();
+    if (next <= now) {
+        return ZJS_TICKS_NONE;
+    }
+    return (s32_t)((next - now) * 1000 / OC_CLOCK_SECOND);
 }
 
 static const oc_handler_t handler = {
@@ -507,11 +520,18 @@ static ZJS_DECL_FUNC(ocf_start)
     if (oc_main_init(&handler) < 0) {
         return zjs_error("OCF failed to start");
     }
+    if (!ocf_routine) {
+        ocf_routine = zjs_register_service_routine(NULL, main_poll_routine);
+    }
     return ZJS_UNDEFINED;
 }
 
 static void zjs_ocf_cleanup(void *native)
 {
+    if (ocf_routine) {
+        ocf_routine = NULL;
+        zjs_unregister_service_routine(main_poll_routine);
+    }
 #ifdef OC_SERVER
     zjs_ocf_server_cleanup();
 #endif
@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // C includes
 #include <stdio.h>
@@ -50,13 +50,6 @@ void zjs_ocf_encode_value(jerry_value_t object);
  */
 jerry_value_t zjs_ocf_decode_value(oc_rep_t *data);
 
-/**
- * Routine to call into iotivity-constrained
- *
- * @return              Time (ms) until next event
- */
-s32_t main_poll_routine(void *handle);
-
 /**
  * Set the 'uuid' property in the device object. This API is required because
  * we dont get the UUID until after the device object is created/initialized.
@@ -1,12 +1,17 @@
 // Copyright (c) 2016, Linaro Limited.
 #ifdef BUILD_MODULE_PERFORMANCE
 
-#ifdef ZJS_LINUX_BUILD
 // C includes
+#include <string.h>
+#ifdef ZJS_LINUX_BUILD
 #include <sys/time.h>
 #endif
 
 // ZJS includes
+#include "zjs_callbacks.h"
+#include "zjs_loop_stats.h"
+#include "zjs_modules.h"
+#include "zjs_timers.h"
 #include "zjs_util.h"
 
 static ZJS_DECL_FUNC(zjs_performance_now)
@@ -23,11 +28,167 @@ static ZJS_DECL_FUNC(zjs_performance_now)
     return jerry_create_number((double)useconds / 1000);
 }
 
+static ZJS_DECL_FUNC(zjs_performance_callback_stats)
+{
+    zjs_callback_stats_t stats;
+    zjs_get_callback_stats(&stats);
+
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "dropped", stats.dropped);
+    zjs_obj_add_number(obj, "spilled", stats.spilled);
+    zjs_obj_add_number(obj, "pauses", stats.pauses);
+    zjs_obj_add_number(obj, "highWater", stats.high_water);
+    zjs_obj_add_number(obj, "pending", stats.pending);
+    zjs_obj_add_number(obj, "queueSize", stats.queue_size);
+    return obj;
+}
+
+static ZJS_DECL_FUNC(zjs_performance_timer_stats)
+{
+    zjs_timer_stats_t stats;
+    zjs_get_timer_stats(&stats);
+
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "expirations", stats.expirations);
+    zjs_obj_add_number(obj, "wakeups", stats.wakeups);
+    zjs_obj_add_number(obj, "wakeupsSaved", stats.expirations - stats.wakeups);
+    return obj;
+}
+
+static ZJS_DECL_FUNC(zjs_performance_require_stats)
+{
+    zjs_require_stats_t stats;
+    zjs_get_require_stats(&stats);
+
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "hits", stats.hits);
+    zjs_obj_add_number(obj, "misses", stats.misses);
+    return obj;
+}
+
+#ifdef ZJS_LOOP_STATS
+static ZJS_DECL_FUNC(zjs_performance_event_loop_utilization)
+{
+    // args: [previous result]
+    ZJS_VALIDATE_ARGS(Z_OPTIONAL Z_OBJECT);
+
+    zjs_loop_stats_t stats;
+    zjs_get_loop_stats(&stats);
+
+    static const char *names[] = {
+        "callbacks", "timers", "routines", "immediates", "jobs", "other",
+        "idle"
+    };
+    double ms[ZJS_LOOP_PHASES];
+    double active = 0;
+    for (int i = 0; i < ZJS_LOOP_PHASES; i++) {
+        ms[i] = (double)stats.time_us[i] / 1000;
+        if (argc >= 1) {
+            // report the difference since an earlier call
+            double prev;
+            if (zjs_obj_get_double(argv[0], names[i], &prev)) {
+                ms[i] -= prev;
+            }
+        }
+        if (i != ZJS_LOOP_IDLE) {
+            active += ms[i];
+        }
+    }
+
+    jerry_value_t obj = zjs_create_object();
+    for (int i = 0; i < ZJS_LOOP_PHASES; i++) {
+        zjs_obj_add_number(obj, names[i], ms[i]);
+    }
+    double total = active + ms[ZJS_LOOP_IDLE];
+    zjs_obj_add_number(obj, "active", active);
+    zjs_obj_add_number(obj, "utilization", total > 0 ? active / total : 0);
+    return obj;
+}
+
+static ZJS_DECL_FUNC(zjs_performance_monitor_event_loop_delay)
+{
+    // args: [reset]
+    ZJS_VALIDATE_ARGS(Z_OPTIONAL Z_BOOL);
+
+    zjs_loop_stats_t stats;
+    zjs_get_loop_stats(&stats);
+
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "count", stats.iterations);
+    zjs_obj_add_number(obj, "min", (double)stats.lag_min_us / 1000);
+    zjs_obj_add_number(obj, "max", (double)stats.lag_max_us / 1000);
+    zjs_obj_add_number(obj, "mean", stats.iterations ?
+                       (double)stats.lag_sum_us / stats.iterations / 1000 : 0);
+    zjs_obj_add_number(obj, "p50",
+                       (double)zjs_loop_lag_percentile(&stats, 50) / 1000);
+    zjs_obj_add_number(obj, "p90",
+                       (double)zjs_loop_lag_percentile(&stats, 90) / 1000);
+    zjs_obj_add_number(obj, "p99",
+                       (double)zjs_loop_lag_percentile(&stats, 99) / 1000);
+    zjs_obj_add_number(obj, "queueMax", stats.queue_max);
+    zjs_obj_add_number(obj, "queueMean", stats.iterations ?
+                       (double)stats.queue_sum / stats.iterations : 0);
+
+    if (argc >= 1 && jerry_get_boolean_value(argv[0])) {
+        zjs_reset_loop_lag();
+    }
+    return obj;
+}
+
+static ZJS_DECL_FUNC(zjs_performance_callback_latency)
+{
+    u32_t count = 0;
+    zjs_callback_latency_t latency;
+    while (zjs_get_callback_latency(count, &latency)) {
+        count++;
+    }
+
+    jerry_value_t array = jerry_create_array(count);
+    for (u32_t i = 0; i < count; i++) {
+        zjs_callback_latency_t *entry = &latency;
+        zjs_get_callback_latency(i, entry);
+        ZVAL obj = zjs_create_object();
+        const char *module = strrchr(entry->module, '/');
+        zjs_obj_add_string(obj, "module", module ? module + 1 : entry->module);
+        if (entry->id >= 0) {
+            zjs_obj_add_number(obj, "id", entry->id);
+        }
+        zjs_obj_add_number(obj, "count", entry->count);
+        zjs_obj_add_number(obj, "waitMean", (double)entry->wait_sum_us /
+                                            entry->count / 1000);
+        zjs_obj_add_number(obj, "waitP99", (double)zjs_latency_percentile(
+                                           entry->wait_hist, 99) / 1000);
+        zjs_obj_add_number(obj, "waitMax", (double)entry->wait_max_us / 1000);
+        zjs_obj_add_number(obj, "runMean", (double)entry->run_sum_us /
+                                           entry->count / 1000);
+        zjs_obj_add_number(obj, "runP99", (double)zjs_latency_percentile(
+                                          entry->run_hist, 99) / 1000);
+        zjs_obj_add_number(obj, "runMax", (double)entry->run_max_us / 1000);
+        jerry_set_property_by_index(array, i, obj);
+    }
+    return array;
+}
+#endif
+
 static jerry_value_t zjs_performance_init()
 {
     // create global performance object
     jerry_value_t performance_obj = zjs_create_object();
     zjs_obj_add_function(performance_obj, "now", zjs_performance_now);
+    zjs_obj_add_function(performance_obj, "callbackStats",
+                         zjs_performance_callback_stats);
+    zjs_obj_add_function(performance_obj, "timerStats",
+                         zjs_performance_timer_stats);
+    zjs_obj_add_function(performance_obj, "requireStats",
+                         zjs_performance_require_stats);
+#ifdef ZJS_LOOP_STATS
+    zjs_obj_add_function(performance_obj, "eventLoopUtilization",
+                         zjs_performance_event_loop_utilization);
+    zjs_obj_add_function(performance_obj, "monitorEventLoopDelay",
+                         zjs_performance_monitor_event_loop_delay);
+    zjs_obj_add_function(performance_obj, "callbackLatency",
+                         zjs_performance_callback_latency);
+#endif
     return performance_obj;
 }
 
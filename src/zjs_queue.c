@@ -0,0 +1,142 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// C includes
+#include <string.h>
+
+// ZJS includes
+#include "zjs_queue.h"
+
+// Header word layout: payload length in words, app value, and flags
+#define INFO_LENGTH_MASK  0xffff
+#define INFO_VALUE_SHIFT  16
+#define INFO_COMMITTED    (1 << 24)
+#define INFO_PAD          (1 << 25)
+
+#define INFO(q, pos)  ((zjs_port_atomic_t *)&(q)->buf[(pos) & (q)->mask])
+
+void zjs_queue_init(zjs_queue_t *queue, u32_t *buf, u32_t size32)
+{
+    // requires: size32 is a power of 2 and at least 2 * header size
+    memset(buf, 0, size32 * sizeof(u32_t));
+    queue->buf = buf;
+    queue->size = size32;
+    queue->mask = size32 - 1;
+    queue->tail = 0;
+    queue->head = 0;
+    queue->read = 0;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+u32_t *zjs_queue_reserve(zjs_queue_t *queue, u32_t type, u8_t value,
+                         u16_t size32)
+{
+    u32_t need = ZJS_QUEUE_HEADER_SIZE32 + size32;
+    if (need > queue->size / 2) {
+        // a record this big might never find contiguous room
+        return NULL;
+    }
+
+    u32_t tail, pos, pad;
+    do {
+        tail = (u32_t)zjs_port_atomic_get(&queue->tail);
+        u32_t head = (u32_t)zjs_port_atomic_get(&queue->head);
+        pos = tail & queue->mask;
+        pad = (pos + need > queue->size) ? queue->size - pos : 0;
+        if (tail + pad + need - head > queue->size) {
+            return NULL;
+        }
+    } while (!zjs_port_atomic_cas(&queue->tail, (zjs_port_atomic_t)tail,
+                                  (zjs_port_atomic_t)(tail + pad + need)));
+
+    if (pad) {
+        // the consumer skips straight to the start of the buffer
+        zjs_port_atomic_set(INFO(queue, pos), INFO_PAD | INFO_COMMITTED);
+        pos = 0;
+    }
+
+    // the header stays uncommitted until zjs_queue_commit, so the info word
+    //   doubles as storage for length and value until then
+    queue->buf[pos] = size32 | ((u32_t)value << INFO_VALUE_SHIFT);
+    queue->buf[pos + 1] = type;
+    return &queue->buf[pos + ZJS_QUEUE_HEADER_SIZE32];
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+void zjs_queue_commit(zjs_queue_t *queue, u32_t *data)
+{
+    zjs_port_atomic_t *info =
+        (zjs_port_atomic_t *)(data - ZJS_QUEUE_HEADER_SIZE32);
+    // the atomic store orders the payload writes before the committed bit
+    zjs_port_atomic_set(info, *info | INFO_COMMITTED);
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+int zjs_queue_put(zjs_queue_t *queue, u32_t type, u8_t value,
+                  const void *data, u32_t bytes)
+{
+    u32_t size32 = (bytes + 3) / 4;
+    if (ZJS_QUEUE_HEADER_SIZE32 + size32 > queue->size / 2) {
+        return -EMSGSIZE;
+    }
+    u32_t *payload = zjs_queue_reserve(queue, type, value, (u16_t)size32);
+    if (!payload) {
+        return -ENOSPC;
+    }
+    if (bytes) {
+        memcpy(payload, data, bytes);
+    }
+    zjs_queue_commit(queue, payload);
+    return 0;
+}
+
+u32_t *zjs_queue_peek(zjs_queue_t *queue, u32_t *type, u8_t *value,
+                      u16_t *size32)
+{
+    while (queue->read != (u32_t)zjs_port_atomic_get(&queue->tail)) {
+        u32_t pos = queue->read & queue->mask;
+        u32_t info = (u32_t)zjs_port_atomic_get(INFO(queue, pos));
+        if (!(info & INFO_COMMITTED)) {
+            // a producer is still filling this one in; keep FIFO order
+            return NULL;
+        }
+        if (info & INFO_PAD) {
+            queue->read += queue->size - pos;
+            continue;
+        }
+
+        u16_t len = info & INFO_LENGTH_MASK;
+        *type = queue->buf[pos + 1];
+        *value = (u8_t)(info >> INFO_VALUE_SHIFT);
+        *size32 = len;
+        queue->read += ZJS_QUEUE_HEADER_SIZE32 + len;
+        return &queue->buf[pos + ZJS_QUEUE_HEADER_SIZE32];
+    }
+    return NULL;
+}
+
+void zjs_queue_release(zjs_queue_t *queue)
+{
+    u32_t head = (u32_t)queue->head;
+    if (head == queue->read) {
+        return;
+    }
+
+    // producers rely on unpublished headers reading as uncommitted, so clear
+    //   the released words before handing them back
+    u32_t start = head & queue->mask;
+    u32_t count = queue->read - head;
+    u32_t first = queue->size - start;
+    if (count <= first) {
+        memset(&queue->buf[start], 0, count * sizeof(u32_t));
+    } else {
+        memset(&queue->buf[start], 0, first * sizeof(u32_t));
+        memset(queue->buf, 0, (count - first) * sizeof(u32_t));
+    }
+    zjs_port_atomic_set(&queue->head, (zjs_port_atomic_t)queue->read);
+}
+
+u32_t zjs_queue_used(zjs_queue_t *queue)
+{
+    return (u32_t)zjs_port_atomic_get(&queue->tail) -
+           (u32_t)zjs_port_atomic_get(&queue->head);
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_queue_h__
+#define __zjs_queue_h__
+
+/*
+ * Lock-free multi-producer, single-consumer record queue
+ *
+ * Producers (threads or ISRs) claim space with a compare-and-swap on the tail
+ * counter, fill the record in place, and then publish it by setting the
+ * committed bit in its header. The single consumer (the main loop) walks
+ * committed records in order without copying them out, and hands the space
+ * back to producers in one step with zjs_queue_release().
+ *
+ * Each record is two header words followed by a contiguous payload, so a
+ * record never wraps around the end of the buffer; producers skip to the
+ * start with a padding record instead.
+ */
+
+// ZJS includes
+#include "zjs_util.h"
+
+typedef struct zjs_queue {
+    u32_t *buf;               // storage, size words long
+    u32_t size;               // size of buf in 32-bit words, a power of 2
+    u32_t mask;               // size - 1
+    zjs_port_atomic_t tail;   // free-running word counter, end of reserved
+    zjs_port_atomic_t head;   // free-running word counter, start of unreleased
+    u32_t read;               // consumer cursor, end of records peeked so far
+} zjs_queue_t;
+
+// number of header words in front of every record
+#define ZJS_QUEUE_HEADER_SIZE32 2
+
+/**
+ * Initialize a queue over caller-provided storage
+ *
+ * @param queue   Queue to initialize
+ * @param buf     Storage for the records, will be zeroed
+ * @param size32  Size of buf in 32-bit words, must be a power of 2
+ */
+void zjs_queue_init(zjs_queue_t *queue, u32_t *buf, u32_t size32);
+
+/**
+ * Reserve room for a record to be filled in place and committed later
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param queue   Queue to reserve from
+ * @param type    Application-specific tag stored with the record
+ * @param value   Application-specific small value stored with the record
+ * @param size32  Payload size in 32-bit words
+ *
+ * @return        Pointer to the payload, or NULL if the queue is full or the
+ *                  record could never fit
+ */
+u32_t *zjs_queue_reserve(zjs_queue_t *queue, u32_t type, u8_t value,
+                         u16_t size32);
+
+/**
+ * Publish a record previously returned by zjs_queue_reserve
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param queue  Queue the record was reserved from
+ * @param data   Payload pointer returned by zjs_queue_reserve
+ */
+void zjs_queue_commit(zjs_queue_t *queue, u32_t *data);
+
+/**
+ * Reserve, copy and commit a record in one call
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param queue  Queue to write to
+ * @param type   Application-specific tag stored with the record
+ * @param value  Application-specific small value stored with the record
+ * @param data   Payload to copy, may be NULL if bytes is 0
+ * @param bytes  Payload size in bytes
+ *
+ * @return       0 on success, -ENOSPC if the queue is full, -EMSGSIZE if
+ *                 the record is larger than half the queue
+ */
+int zjs_queue_put(zjs_queue_t *queue, u32_t type, u8_t value,
+                  const void *data, u32_t bytes);
+
+/**
+ * Get the next committed record without releasing it
+ *
+ * Only the consumer may call this. The returned payload stays valid until
+ * zjs_queue_release is called.
+ *
+ * @param queue   Queue to read from
+ * @param type    Receives the record tag
+ * @param value   Receives the record value
+ * @param size32  Receives the payload size in 32-bit words
+ *
+ * @return        Pointer to the payload, or NULL if there are no committed
+ *                  records left
+ */
+u32_t *zjs_queue_peek(zjs_queue_t *queue, u32_t *type, u8_t *value,
+                      u16_t *size32);
+
+/**
+ * Hand back all records returned by zjs_queue_peek so far to producers
+ *
+ * @param queue  Queue to release records from
+ */
+void zjs_queue_release(zjs_queue_t *queue);
+
+/**
+ * Get the number of words currently reserved, committed or unreleased
+ *
+ * @param queue  Queue to examine
+ *
+ * @return       Words in use, including headers and padding
+ */
+u32_t zjs_queue_used(zjs_queue_t *queue);
+
+#endif  // __zjs_queue_h__
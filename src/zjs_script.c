@@ -1,10 +1,17 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifdef ZJS_LINUX_BUILD
 
 // C includes
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // ZJS includes
 #include "zjs_script.h"
@@ -56,4 +63,174 @@ uint8_t zjs_read_script(char *name, char **script, uint32_t *length)
 
     return 0;
 }
+
+bool zjs_script_is_snapshot(const char *name)
+{
+    size_t len = strlen(name);
+    size_t ext_len = strlen(ZJS_SNAPSHOT_EXT);
+    return len > ext_len && !strcmp(name + len - ext_len, ZJS_SNAPSHOT_EXT);
+}
+
+uint8_t zjs_map_snapshot(const char *name, const uint32_t **snapshot,
+                         uint32_t *length)
+{
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        ERR_PRINT("error opening file '%s'\n", name);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size == 0) {
+        ERR_PRINT("error reading size of file '%s'\n", name);
+        close(fd);
+        return 1;
+    }
+    // the mapping is never undone, since the engine keeps pointing into it
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ERR_PRINT("error mapping file '%s'\n", name);
+        return 1;
+    }
+    *snapshot = (const uint32_t *)map;
+    *length = st.st_size;
+    return 0;
+}
+
+jerry_value_t zjs_exec_snapshot(const uint32_t *snapshot, uint32_t length)
+{
+    if (length % sizeof(uint32_t)) {
+        return jerry_create_error(JERRY_ERROR_RANGE,
+                                  (jerry_char_t *)"truncated snapshot");
+    }
+    return jerry_exec_snapshot(snapshot, length, 0,
+                               JERRY_SNAPSHOT_EXEC_ALLOW_STATIC);
+}
+
+uint32_t zjs_generate_snapshot(const char *script, uint32_t length,
+                               uint32_t *buf, uint32_t buf_size,
+                               bool *is_static)
+{
+    // static literals can't hold everything, e.g. regular expressions, so
+    //   fall back to a snapshot that loads its literals into the heap
+    static const uint32_t opts[] = { JERRY_SNAPSHOT_SAVE_STATIC, 0 };
+    for (int i = 0; i < sizeof(opts) / sizeof(opts[0]); i++) {
+        jerry_value_t ret = jerry_generate_snapshot(NULL, 0,
+                                                    (jerry_char_t *)script,
+                                                    length, opts[i], buf,
+                                                    buf_size);
+        uint32_t size = 0;
+        if (!jerry_value_is_error(ret)) {
+            size = (uint32_t)jerry_get_number_value(ret);
+        }
+        jerry_release_value(ret);
+        if (size) {
+            if (is_static) {
+                *is_static = opts[i] & JERRY_SNAPSHOT_SAVE_STATIC;
+            }
+            return size;
+        }
+    }
+    return 0;
+}
+
+// FNV-1a, 64 bits so distinct scripts practically never share a key
+static uint64_t hash_bytes(uint64_t hash, const void *data, uint32_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (uint32_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t engine_hash(void)
+{
+    // a snapshot of a trivial script captures the snapshot version, feature
+    //   flags and code generation of this engine build, so hashing it keeps
+    //   snapshots from other builds from ever being loaded
+    static uint64_t hash = 0;
+    if (!hash) {
+        static const char probe[] = "0";
+        uint32_t buf[64];
+        jerry_value_t ret = jerry_generate_snapshot(NULL, 0,
+                                                    (jerry_char_t *)probe,
+                                                    strlen(probe), 0, buf,
+                                                    sizeof(buf));
+        uint32_t size = 0;
+        if (!jerry_value_is_error(ret)) {
+            size = (uint32_t)jerry_get_number_value(ret);
+        }
+        jerry_release_value(ret);
+        hash = hash_bytes(0xcbf29ce484222325ULL, buf, size);
+    }
+    return hash;
+}
+
+static void store_snapshot(const char *path, const uint32_t *snapshot,
+                           uint32_t size)
+{
+    // write to a private file and rename it into place, so other instances
+    //   starting at the same time never see a partial snapshot
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        ERR_PRINT("could not create snapshot cache file '%s'\n", tmp);
+        return;
+    }
+    bool ok = fwrite(snapshot, size, 1, f) == 1;
+    if (fclose(f) || !ok || rename(tmp, path)) {
+        ERR_PRINT("could not write snapshot cache file '%s'\n", path);
+        unlink(tmp);
+    }
+}
+
+zjs_cache_status_t zjs_run_cached_script(const char *dir, const char *script,
+                                         uint32_t length,
+                                         jerry_value_t *result)
+{
+    char path[PATH_MAX];
+    uint64_t hash = hash_bytes(engine_hash(), script, length);
+    snprintf(path, sizeof(path), "%s/%016llx%s", dir, (unsigned long long)hash,
+             ZJS_SNAPSHOT_EXT);
+
+    if (access(path, R_OK) == 0) {
+        const uint32_t *snapshot;
+        uint32_t size;
+        if (!zjs_map_snapshot(path, &snapshot, &size)) {
+            *result = zjs_exec_snapshot(snapshot, size);
+            return ZJS_CACHE_HIT;
+        }
+    }
+
+    // snapshots are rarely much larger than the source; if this one doesn't
+    //   fit, it just runs uncached
+    uint32_t buf_size = 4 * length + 1024;
+    uint32_t *buf = (uint32_t *)malloc(buf_size);
+    if (!buf) {
+        return ZJS_CACHE_UNUSED;
+    }
+    uint32_t size = zjs_generate_snapshot(script, length, buf, buf_size, NULL);
+    if (!size) {
+        free(buf);
+        return ZJS_CACHE_UNUSED;
+    }
+
+    if (mkdir(dir, 0755) && errno != EEXIST) {
+        ERR_PRINT("could not create snapshot cache directory '%s'\n", dir);
+    } else {
+        store_snapshot(path, buf, size);
+    }
+
+    // this run also executes in place, so like a mapped file the buffer is
+    //   kept for the life of the program
+    uint32_t *snapshot = (uint32_t *)realloc(buf, size);
+    if (snapshot) {
+        buf = snapshot;
+    }
+    *result = zjs_exec_snapshot(buf, size);
+    return ZJS_CACHE_MISS;
+}
 #endif
@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef ZJS_SCRIPT_H_
 #define ZJS_SCRIPT_H_
@@ -8,4 +8,95 @@
 
 uint8_t zjs_read_script(char *name, char **script, uint32_t *length);
 
+#ifdef ZJS_LINUX_BUILD
+// JerryScript includes
+#include "jerryscript.h"
+
+// file name extension of precompiled snapshots
+#define ZJS_SNAPSHOT_EXT ".snapshot"
+
+typedef enum zjs_cache_status {
+    ZJS_CACHE_UNUSED,   // not compiled to a snapshot, parse it instead
+    ZJS_CACHE_MISS,     // compiled and stored in the cache, then run
+    ZJS_CACHE_HIT       // run from a cached snapshot
+} zjs_cache_status_t;
+
+/**
+ * Check whether a file name refers to a precompiled snapshot
+ *
+ * @param name          File name given on the command line
+ *
+ * @return              True if the name ends in ZJS_SNAPSHOT_EXT
+ */
+bool zjs_script_is_snapshot(const char *name);
+
+/**
+ * Map a snapshot file into memory read-only, so it can run in place
+ *
+ * The mapping stays for the life of the program, and its pages are shared
+ * with every other instance running the same file.
+ *
+ * @param name          Snapshot file name
+ * @param snapshot      Receives the start of the mapping
+ * @param length        Receives the snapshot size in bytes
+ *
+ * @return              0 on success, 1 on error
+ */
+uint8_t zjs_map_snapshot(const char *name, const uint32_t **snapshot,
+                         uint32_t *length);
+
+/**
+ * Run a snapshot in place, without copying its bytecode into the JS heap
+ *
+ * Static snapshots keep their literals in the snapshot too, so they cost no
+ * heap at all. The engine keeps pointing into the snapshot afterwards.
+ *
+ * @param snapshot      Snapshot contents, word aligned and valid for the life
+ *                        of the program
+ * @param length        Snapshot size in bytes
+ *
+ * @return              Result of the script, an error if it threw or the
+ *                        snapshot was invalid
+ */
+jerry_value_t zjs_exec_snapshot(const uint32_t *snapshot, uint32_t length);
+
+/**
+ * Compile a script to a snapshot, with static literals where possible
+ *
+ * @param script        Script source
+ * @param length        Script size in bytes
+ * @param buf           Receives the snapshot
+ * @param buf_size      Size of buf in bytes
+ * @param is_static     Receives whether the literals are static, may be NULL
+ *
+ * @return              Snapshot size in bytes, or 0 if the script failed to
+ *                        parse or didn't fit
+ */
+uint32_t zjs_generate_snapshot(const char *script, uint32_t length,
+                               uint32_t *buf, uint32_t buf_size,
+                               bool *is_static);
+
+/**
+ * Run a script through an on-disk cache of snapshots
+ *
+ * Snapshots are stored in dir under a hash of the script contents and of the
+ * engine's snapshot format, so an unchanged script skips the parser and an
+ * engine upgrade just misses. On a miss the script is compiled to a snapshot,
+ * stored and run from it, so it is still only parsed once.
+ *
+ * @param dir           Cache directory, created if missing
+ * @param script        Script source
+ * @param length        Script size in bytes
+ * @param result        Receives the result of the script, unless the status
+ *                        is ZJS_CACHE_UNUSED
+ *
+ * @return              ZJS_CACHE_UNUSED if the script could not be compiled,
+ *                        e.g. because of a syntax error, and should be parsed
+ *                        as usual so the error gets reported
+ */
+zjs_cache_status_t zjs_run_cached_script(const char *dir, const char *script,
+                                         uint32_t length,
+                                         jerry_value_t *result);
+#endif
+
 #endif /* ZJS_SCRIPT_H_ */
@@ -341,6 +341,8 @@ ZJS_DECL_FUNC_ARGS(zjs_sensor_create,
 
     handle->sensor_obj = jerry_acquire_value(sensor_obj);
     handle->onchange_cb_id = zjs_add_c_callback(handle, onchange);
+    // readings are level-style, so only the newest one is worth delivering
+    zjs_coalesce_callback(handle->onchange_cb_id, 3 * sizeof(double));
     handle->onstart_cb_id = zjs_add_c_callback(handle, onstart);
     handle->onstop_cb_id = zjs_add_c_callback(handle, onstop);
 
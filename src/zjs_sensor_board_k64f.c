@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // C includes
 #include <string.h>
@@ -36,6 +36,7 @@ typedef struct sensor_module {
     initcb_t init;
     cleanupcb_t cleanup;
     sensor_instance_t *instance;
+    u32_t next_sample;  // uptime (ms) when the module is sampled again
 } sensor_module_t;
 
 sensor_module_t sensor_modules[] = {
@@ -56,6 +57,8 @@ sensor_module_t sensor_modules[] = {
 #endif
 };
 
+static zjs_routine_t *sensor_routine = NULL;
+
 int zjs_sensor_board_start(sensor_handle_t *handle)
 {
     if (!handle->controller->dev) {
@@ -75,6 +78,8 @@ int zjs_sensor_board_start(sensor_handle_t *handle)
         return -1;
     }
 
+    // start polling right away instead of on the next deadline
+    zjs_wake_service_routine(sensor_routine);
     return 0;
 }
 
@@ -155,25 +160,29 @@ static s32_t zjs_sensor_poll_routine(void *h)
 {
     int modcount = sizeof(sensor_modules) / sizeof(sensor_module_t);
     u32_t uptime = k_uptime_get_32();
+    s32_t wait = K_FOREVER;
 
     for (int i = 0; i < modcount; i++) {
         sensor_module_t *mod = &sensor_modules[i];
         if (mod->instance && mod->instance->handles) {
             sensor_handle_t *handle = mod->instance->handles;
-            if (uptime % (u32_t)(CONFIG_SYS_CLOCK_TICKS_PER_SEC /
-                                 handle->frequency * 10) == 0) {
+            if ((s32_t)(uptime - mod->next_sample) >= 0) {
                 zjs_sensor_fetch_sample(handle);
+                mod->next_sample = uptime + 1000 / handle->frequency;
+            }
+            s32_t left = (s32_t)(mod->next_sample - uptime);
+            if (wait == K_FOREVER || left < wait) {
+                wait = left;
             }
         }
     }
-
-    zjs_loop_unblock();
-    return K_FOREVER;
+    return wait;
 }
 
 void zjs_sensor_board_init()
 {
-    zjs_register_service_routine(NULL, zjs_sensor_poll_routine);
+    sensor_routine = zjs_register_service_routine(NULL,
+                                                  zjs_sensor_poll_routine);
 
     int modcount = sizeof(sensor_modules) / sizeof(sensor_module_t);
     for (int i = 0; i < modcount; i++) {
@@ -194,5 +203,6 @@ void zjs_sensor_board_cleanup()
         }
         mod->instance = NULL;
     }
+    sensor_routine = NULL;
     zjs_unregister_service_routine(zjs_sensor_poll_routine);
 }
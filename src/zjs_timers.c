@@ -16,67 +16,202 @@
 
 // ZJS includes
 #include "zjs_callbacks.h"
+#include "zjs_timers.h"
 #include "zjs_util.h"
 
+// initial number of slots in the timer heap, doubled when it fills up
+#define INITIAL_HEAP_SIZE 8
+
+// slack in ms for timers that don't set their own with setSlack()
+#ifndef ZJS_TIMER_SLACK
+#define ZJS_TIMER_SLACK 0
+#endif
+
+// All timers live in one heap polled from the main loop, so expirations that
+// fall close together share a wakeup instead of each arming a hardware timer.
+// A timer with slack may fire up to that many ms late; the loop sleeps until
+// the earliest end of any timer's slack window and then fires every timer
+// that is due, so timers with similar periods drift into the same wakeups.
 typedef struct zjs_timer {
-    zjs_port_timer_t timer;
     jerry_value_t *argv;
     u32_t argc;
     zjs_callback_id callback_id;
     bool repeat;
-#ifdef ZJS_LINUX_BUILD
-    // FIXME - reverted patch #1542 to old timer implementation
-    u32_t interval;
+    bool has_obj;   // the JS timer object still references this struct
     bool completed;
-#endif
-    struct zjs_timer *next;
+    u32_t interval;
+    u32_t slack;    // ms the timer may fire late to share a wakeup
+    u32_t expires;  // absolute uptime in ms when the timer is due
+    u32_t seq;      // insertion order, breaks ties between equal deadlines
+    s32_t index;    // position in timer_heap, -1 once the timer is deleted
 } zjs_timer_t;
 
-static zjs_timer_t *zjs_timers = NULL;
+// a pending setImmediate or process.nextTick call, with its args inline
+typedef struct immediate {
+    struct immediate *next;
+    jerry_value_t func;  // undefined once run or cleared
+    bool has_obj;        // the JS immediate object still references this struct
+    bool queued;
+    u32_t argc;
+    jerry_value_t argv[0];
+} immediate_t;
+
+typedef struct immediate_queue {
+    immediate_t *head;
+    immediate_t *tail;
+} immediate_queue_t;
+
+static immediate_queue_t immediates = { NULL, NULL };
+static immediate_queue_t ticks = { NULL, NULL };
+
+static void free_immediate_handle(void *native);
+
+static const jerry_object_native_info_t immediate_type_info = {
+    .free_cb = free_immediate_handle
+};
+
+// binary min-heap of active timers ordered by expiration time
+static zjs_timer_t **timer_heap = NULL;
+static u32_t heap_count = 0;
+static u32_t heap_size = 0;
+static u32_t timer_seq = 0;
+
+static zjs_timer_stats_t timer_stats = { 0, 0 };
+
+static jerry_value_t timer_prototype = 0;
+
+static void free_timer_handle(void *native);
 
 static const jerry_object_native_info_t timer_type_info = {
-    .free_cb = free_handle_nop
+    .free_cb = free_timer_handle
 };
 
-#ifdef ZJS_LINUX_BUILD
-// FIXME - reverted patch #1542 to old timer implementation
-jerry_value_t *pre_timer(void *h, u32_t *argc)
+static inline bool timer_before(zjs_timer_t *a, zjs_timer_t *b)
 {
-    zjs_timer_t *handle = (zjs_timer_t *)h;
-    *argc = handle->argc;
-    return handle->argv;
+    // compare with signed difference so uptime wraparound is handled
+    s32_t diff = (s32_t)(a->expires - b->expires);
+    if (diff != 0) {
+        return diff < 0;
+    }
+    return (s32_t)(a->seq - b->seq) < 0;
 }
 
-#define post_timer 0
-#else
-static bool delete_timer(zjs_timer_t *tm);
+static inline void heap_set(u32_t index, zjs_timer_t *tm)
+{
+    timer_heap[index] = tm;
+    tm->index = index;
+}
 
-static void post_timer(void *handle, jerry_value_t ret_val)
+static void heap_sift_up(u32_t index)
 {
-    zjs_timer_t *timer = (zjs_timer_t *)handle;
+    zjs_timer_t *tm = timer_heap[index];
+    while (index > 0) {
+        u32_t parent = (index - 1) / 2;
+        if (!timer_before(tm, timer_heap[parent])) {
+            break;
+        }
+        heap_set(index, timer_heap[parent]);
+        index = parent;
+    }
+    heap_set(index, tm);
+}
 
-    if (!timer->repeat) {
-        delete_timer(timer);
+static void heap_sift_down(u32_t index)
+{
+    zjs_timer_t *tm = timer_heap[index];
+    while (1) {
+        u32_t child = 2 * index + 1;
+        if (child >= heap_count) {
+            break;
+        }
+        if (child + 1 < heap_count &&
+            timer_before(timer_heap[child + 1], timer_heap[child])) {
+            child++;
+        }
+        if (!timer_before(timer_heap[child], tm)) {
+            break;
+        }
+        heap_set(index, timer_heap[child]);
+        index = child;
     }
+    heap_set(index, tm);
 }
 
-static void timer_callback(zjs_port_timer_t *handle)
+static bool heap_insert(zjs_timer_t *tm)
 {
-    zjs_timer_t *timer = (zjs_timer_t *)handle->user_data;
+    if (heap_count == heap_size) {
+        u32_t new_size = heap_size ? heap_size * 2 : INITIAL_HEAP_SIZE;
+        zjs_timer_t **new_heap = zjs_malloc(sizeof(zjs_timer_t *) * new_size);
+        if (!new_heap) {
+            return false;
+        }
+        if (timer_heap) {
+            memcpy(new_heap, timer_heap, sizeof(zjs_timer_t *) * heap_count);
+            zjs_free(timer_heap);
+        }
+        timer_heap = new_heap;
+        heap_size = new_size;
+    }
+    tm->seq = timer_seq++;
+    heap_set(heap_count++, tm);
+    heap_sift_up(tm->index);
+    return true;
+}
 
-    zjs_signal_callback(timer->callback_id, timer->argv,
-                        sizeof(jerry_value_t) * timer->argc);
+static void heap_remove(zjs_timer_t *tm)
+{
+    // requires: tm is in the heap
+    u32_t index = tm->index;
+    tm->index = -1;
+    if (--heap_count == index) {
+        return;
+    }
+    // move the last timer into the hole and restore heap order
+    heap_set(index, timer_heap[heap_count]);
+    if (index > 0 && timer_before(timer_heap[index],
+                                  timer_heap[(index - 1) / 2])) {
+        heap_sift_up(index);
+    } else {
+        heap_sift_down(index);
+    }
+}
+
+static u32_t window_end(u32_t index, u32_t end)
+{
+    // effects: returns the earliest end of a slack window among the timers in
+    //            the subtree at index, or end if that is earlier; timers due
+    //            at or after end can't lower it, so whole subtrees are skipped
+    if (index >= heap_count) {
+        return end;
+    }
+    zjs_timer_t *tm = timer_heap[index];
+    if ((s32_t)(tm->expires - end) >= 0) {
+        return end;
+    }
+    u32_t tm_end = tm->expires + tm->slack;
+    if ((s32_t)(tm_end - end) < 0) {
+        end = tm_end;
+    }
+    end = window_end(2 * index + 1, end);
+    return window_end(2 * index + 2, end);
+}
 
-    if (!timer->repeat) {
-        zjs_port_timer_stop(handle);
+static void free_timer_handle(void *native)
+{
+    // effects: called when the JS timer object is garbage collected; the
+    //            struct is freed here if the timer was already deleted,
+    //            otherwise it will be freed when the timer is deleted
+    zjs_timer_t *tm = (zjs_timer_t *)native;
+    tm->has_obj = false;
+    if (tm->index < 0) {
+        zjs_free(tm);
     }
 }
-#endif
 
 /*
- * Allocate a new timer and add it to list
+ * Allocate a new timer and schedule it
  *
- * interval     Time until expiration (in ticks)
+ * interval     Time until expiration (in ms)
  * callback     JS callback function
  * repeat       Timeout or interval timer
  * argv         Array of arguments to pass to timer callback function
@@ -95,17 +230,12 @@ static zjs_timer_t *add_timer(u32_t interval,
         return NULL;
     }
 
-#ifdef ZJS_LINUX_BUILD
-    // FIXME - reverted patch #1542 to old timer implementation
-    zjs_port_timer_init(&tm->timer, NULL);
     tm->interval = interval;
+    tm->slack = ZJS_TIMER_SLACK;
+    tm->index = -1;
+    tm->has_obj = false;
     tm->completed = false;
-#else
-    zjs_port_timer_init(&tm->timer, timer_callback);
-    tm->timer.user_data = tm;
-#endif
     tm->repeat = repeat;
-    tm->next = NULL;
     tm->argc = argc;
     if (tm->argc) {
         tm->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
@@ -124,52 +254,56 @@ static zjs_timer_t *add_timer(u32_t interval,
     if (tm->repeat) {
         tm->callback_id = zjs_add_callback(callback, this, tm, NULL);
     } else {
-        tm->callback_id = zjs_add_callback_once(callback, this, tm, post_timer);
+        tm->callback_id = zjs_add_callback_once(callback, this, tm, NULL);
     }
 
-    ZJS_LIST_APPEND(zjs_timer_t, zjs_timers, tm);
-
     DBG_PRINT("add timer, id=%d, interval=%u, repeat=%u, argv=%p, argc=%u\n",
               tm->callback_id, interval, repeat, argv, argc);
-#ifdef ZJS_LINUX_BUILD
-    // FIXME - reverted patch #1542 to old timer implementation
-    zjs_port_timer_start(&tm->timer, interval, 0);
-#else
-    zjs_port_timer_start(&tm->timer, repeat ? interval : 0, interval);
-#endif
+    tm->expires = zjs_port_timer_get_uptime() + interval;
+    if (!heap_insert(tm)) {
+        ERR_PRINT("out of memory growing timer heap\n");
+        for (int i = 0; i < tm->argc; ++i) {
+            jerry_release_value(tm->argv[i]);
+        }
+        zjs_remove_callback(tm->callback_id);
+        zjs_free(tm->argv);
+        zjs_free(tm);
+        return NULL;
+    }
+    // wake the main loop so it recomputes how long it can sleep
+    zjs_loop_unblock();
     return tm;
 }
 
 /*
- * Remove a timer from the list
+ * Stop a timer and release its resources
  *
- * id           ID of timer, returned from add_timer
+ * tm           Timer returned from add_timer
  *
- * returns      True if the timer was removed successfully (if the ID is valid)
+ * returns      True if the timer was removed successfully (if it was active)
  */
 static bool delete_timer(zjs_timer_t *tm)
 {
     if (tm) {
-        // If the timer isn't in the list, its already been deleted
-        if (zjs_timers == NULL ||
-            !ZJS_LIST_REMOVE(zjs_timer_t, zjs_timers, tm)) {
+        // if the timer isn't in the heap, it's already been deleted
+        if (tm->index < 0) {
             return false;
         }
-        zjs_port_timer_stop(&tm->timer);
+        heap_remove(tm);
         for (int i = 0; i < tm->argc; ++i) {
             jerry_release_value(tm->argv[i]);
         }
         // remove callbacks except for expired once timers
-#ifdef ZJS_LINUX_BUILD
-        // FIXME - reverted patch #1542 to old timer implementation
         if (tm->repeat || !tm->completed) {
-#else
-        if (tm->repeat) {
-#endif
             zjs_remove_callback(tm->callback_id);
         }
         zjs_free(tm->argv);
-        zjs_free(tm);
+        tm->argv = NULL;
+        tm->argc = 0;
+        // the JS timer object frees the struct when it's collected
+        if (!tm->has_obj) {
+            zjs_free(tm);
+        }
         return true;
     }
     return false;
@@ -182,7 +316,6 @@ static ZJS_DECL_FUNC_ARGS(add_timer_helper, bool repeat)
 
     u32_t interval = (u32_t)(jerry_get_number_value(argv[1]));
     jerry_value_t callback = argv[0];
-    jerry_value_t timer_obj = zjs_create_object();
 
 #ifdef ZJS_FIND_FUNC_NAME
     if (repeat) {
@@ -195,9 +328,13 @@ static ZJS_DECL_FUNC_ARGS(add_timer_helper, bool repeat)
 #endif
     zjs_timer_t *handle = add_timer(interval, callback, this, repeat,
                                     argc - 2, argv);
-    if (handle->callback_id == -1)
+    if (!handle || handle->callback_id == -1)
         return zjs_error("timer alloc failed");
+
+    jerry_value_t timer_obj = zjs_create_object();
+    jerry_set_prototype(timer_obj, timer_prototype);
     jerry_set_object_native_pointer(timer_obj, handle, &timer_type_info);
+    handle->has_obj = true;
 
     return timer_obj;
 }
@@ -229,41 +366,232 @@ static ZJS_DECL_FUNC(native_clear_interval_handler)
     return ZJS_UNDEFINED;
 }
 
-#ifdef ZJS_LINUX_BUILD
-// FIXME - reverted patch #1542 to old timer implementation
+static ZJS_DECL_FUNC(timer_set_slack)
+{
+    // args: slack in milliseconds
+    ZJS_VALIDATE_ARGS(Z_NUMBER);
+
+    ZJS_GET_HANDLE(this, zjs_timer_t, handle, timer_type_info);
+
+    double slack = jerry_get_number_value(argv[0]);
+    if (slack < 0) {
+        return RANGE_ERROR("slack must not be negative");
+    }
+    handle->slack = (u32_t)slack;
+    // the main loop may be able to sleep longer now
+    zjs_loop_unblock();
+
+    return jerry_acquire_value(this);
+}
+
+static immediate_t *add_immediate(immediate_queue_t *queue,
+                                  jerry_value_t func, const jerry_value_t argv[],
+                                  u32_t argc)
+{
+    // effects: queues a call to func with argv; returns NULL if out of memory
+    immediate_t *im = zjs_malloc(sizeof(immediate_t) +
+                                 argc * sizeof(jerry_value_t));
+    if (!im) {
+        return NULL;
+    }
+    im->next = NULL;
+    im->func = jerry_acquire_value(func);
+    im->has_obj = false;
+    im->queued = true;
+    im->argc = argc;
+    for (int i = 0; i < argc; i++) {
+        im->argv[i] = jerry_acquire_value(argv[i]);
+    }
+
+    if (queue->tail) {
+        queue->tail->next = im;
+    } else {
+        queue->head = im;
+    }
+    queue->tail = im;
+    return im;
+}
+
+static void release_immediate(immediate_t *im)
+{
+    // effects: drops the function and args, so the call will be skipped
+    jerry_release_value(im->func);
+    im->func = ZJS_UNDEFINED;
+    for (int i = 0; i < im->argc; i++) {
+        jerry_release_value(im->argv[i]);
+    }
+    im->argc = 0;
+}
+
+static immediate_t *pop_immediate(immediate_queue_t *queue)
+{
+    // requires: queue is not empty
+    //  effects: removes the first entry; the caller must finish_immediate it
+    immediate_t *im = queue->head;
+    queue->head = im->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    return im;
+}
+
+static void finish_immediate(immediate_t *im)
+{
+    // requires: im has been popped from its queue
+    release_immediate(im);
+    im->queued = false;
+    // the JS immediate object frees the struct when it's collected
+    if (!im->has_obj) {
+        zjs_free(im);
+    }
+}
+
+static void run_immediate(immediate_t *im)
+{
+    // requires: im has been popped from its queue
+    if (!jerry_value_is_undefined(im->func)) {
+        ZVAL rval = jerry_call_function(im->func, ZJS_UNDEFINED, im->argv,
+                                        im->argc);
+        if (jerry_value_is_error(rval)) {
+            zjs_print_error_message(rval, im->func);
+        }
+    }
+    finish_immediate(im);
+}
+
+static void free_immediate_handle(void *native)
+{
+    immediate_t *im = (immediate_t *)native;
+    im->has_obj = false;
+    if (!im->queued) {
+        zjs_free(im);
+    }
+}
+
+// native setImmediate handler
+static ZJS_DECL_FUNC(native_set_immediate_handler)
+{
+    // args: callback[, pass-through args]
+    ZJS_VALIDATE_ARGS(Z_FUNCTION);
+
+    immediate_t *im = add_immediate(&immediates, argv[0], argv + 1, argc - 1);
+    if (!im) {
+        return zjs_error("immediate alloc failed");
+    }
+
+    jerry_value_t immediate_obj = zjs_create_object();
+    jerry_set_object_native_pointer(immediate_obj, im, &immediate_type_info);
+    im->has_obj = true;
+    return immediate_obj;
+}
+
+// native clearImmediate handler
+static ZJS_DECL_FUNC(native_clear_immediate_handler)
+{
+    // args: immediate object
+    ZJS_VALIDATE_ARGS(Z_OBJECT);
+
+    ZJS_GET_HANDLE_OR_NULL(argv[0], immediate_t, handle, immediate_type_info);
+    if (handle && handle->queued) {
+        // leave it in the queue, it will be skipped
+        release_immediate(handle);
+    } else {
+        DBG_PRINT("immediate not found\n");
+    }
+
+    return ZJS_UNDEFINED;
+}
+
+// native process.nextTick handler
+static ZJS_DECL_FUNC(native_next_tick_handler)
+{
+    // args: callback[, pass-through args]
+    ZJS_VALIDATE_ARGS(Z_FUNCTION);
+
+    if (!add_immediate(&ticks, argv[0], argv + 1, argc - 1)) {
+        return zjs_error("nextTick alloc failed");
+    }
+    return ZJS_UNDEFINED;
+}
+
+bool zjs_timers_run_ticks()
+{
+    bool ran = false;
+    // ticks queued by a tick run in the same pass
+    while (ticks.head) {
+        run_immediate(pop_immediate(&ticks));
+        ran = true;
+    }
+    return ran;
+}
+
+bool zjs_timers_run_immediates()
+{
+    // immediates queued from here on wait for the next pass of the loop
+    immediate_t *last = immediates.tail;
+    while (last) {
+        immediate_t *im = pop_immediate(&immediates);
+        run_immediate(im);
+        zjs_timers_run_ticks();
+        if (im == last) {
+            break;
+        }
+    }
+    return immediates.head != NULL;
+}
+
 s32_t zjs_timers_process_events()
 {
-    s32_t wait = ZJS_TICKS_FOREVER;
-    for (zjs_timer_t *tm = zjs_timers; tm; tm = tm->next) {
-        if (tm->completed) {
+    if (heap_count == 0) {
+        return ZJS_TICKS_FOREVER;
+    }
+
+    // read the clock once for all the timers due in this pass
+    u32_t now = zjs_port_timer_get_uptime();
+    bool fired = false;
+    while (heap_count) {
+        zjs_timer_t *tm = timer_heap[0];
+        if ((s32_t)(tm->expires - now) > 0) {
+            break;
+        }
+
+        // timer has expired, signal the callback
+        DBG_PRINT("signaling timer. id=%d, argv=%p, argc=%u\n",
+                  tm->callback_id, tm->argv, tm->argc);
+        zjs_signal_callback(tm->callback_id, tm->argv,
+                            tm->argc * sizeof(jerry_value_t));
+        timer_stats.expirations++;
+        fired = true;
+
+        if (tm->repeat) {
+            // reschedule; always at least 1ms ahead so this pass terminates
+            tm->expires = now + (tm->interval ? tm->interval : 1);
+            tm->seq = timer_seq++;
+            heap_sift_down(0);
+        } else {
+            // the once callback removes itself after it is called
+            tm->completed = true;
             delete_timer(tm);
-        } else if (zjs_port_timer_test(&tm->timer) > 0) {
-            // timer has expired, signal the callback
-            DBG_PRINT("signaling timer. id=%d, argv=%p, argc=%u\n",
-                      tm->callback_id, tm->argv, tm->argc);
-            zjs_signal_callback(tm->callback_id, tm->argv,
-                                tm->argc * sizeof(jerry_value_t));
-
-            // reschedule or remove timer
-            if (tm->repeat) {
-                zjs_port_timer_start(&tm->timer, tm->interval, 0);
-            } else {
-                // delete this timer next time around
-                tm->completed = true;
-            }
         }
+    }
+    if (fired) {
+        timer_stats.wakeups++;
+    }
 
-        /*
-         * On Linux, we don't block on a semaphore; we just need to return if
-         * there were any timers serviced. If there was any timers in the list
-         * then we signal.
-         */
-        wait = 1;
+    if (heap_count == 0) {
+        return ZJS_TICKS_FOREVER;
     }
+    // sleep as long as every timer's slack allows, and fire all that are due
+    //   by then together
+    zjs_timer_t *first = timer_heap[0];
+    u32_t end = window_end(0, first->expires + first->slack);
+    return (s32_t)(end - now);
+}
 
-    return !(wait == ZJS_TICKS_FOREVER);
+void zjs_get_timer_stats(zjs_timer_stats_t *stats)
+{
+    *stats = timer_stats;
 }
-#endif
 
 void zjs_timers_init()
 {
@@ -280,20 +608,36 @@ void zjs_timers_init()
     // create the C handler for clearTimeout JS call (same as clearInterval)
     zjs_obj_add_function(global_obj, "clearTimeout",
                          native_clear_interval_handler);
-}
-
-static void free_timer(zjs_timer_t *tm)
-{
-    for (int i = 0; i < tm->argc; ++i) {
-        jerry_release_value(tm->argv[i]);
+    zjs_obj_add_function(global_obj, "setImmediate",
+                         native_set_immediate_handler);
+    zjs_obj_add_function(global_obj, "clearImmediate",
+                         native_clear_immediate_handler);
+
+    ZVAL process = zjs_get_property(global_obj, "process");
+    if (jerry_value_is_object(process)) {
+        zjs_obj_add_function(process, "nextTick", native_next_tick_handler);
     }
-    zjs_port_timer_stop(&tm->timer);
-    zjs_remove_callback(tm->callback_id);
-    zjs_free(tm->argv);
-    zjs_free(tm);
+
+    timer_prototype = zjs_create_object();
+    zjs_obj_add_function(timer_prototype, "setSlack", timer_set_slack);
 }
 
 void zjs_timers_cleanup()
 {
-    ZJS_LIST_FREE(zjs_timer_t, zjs_timers, free_timer);
+    while (ticks.head) {
+        finish_immediate(pop_immediate(&ticks));
+    }
+    while (immediates.head) {
+        finish_immediate(pop_immediate(&immediates));
+    }
+
+    while (heap_count) {
+        delete_timer(timer_heap[heap_count - 1]);
+    }
+    zjs_free(timer_heap);
+    timer_heap = NULL;
+    heap_size = 0;
+
+    jerry_release_value(timer_prototype);
+    timer_prototype = 0;
 }
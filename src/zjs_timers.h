@@ -1,16 +1,50 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef __zjs_timers_h__
 #define __zjs_timers_h__
 
+#include <stdbool.h>
 #include <stdint.h>
 
+typedef struct zjs_timer_stats {
+    u32_t expirations;  // timer callbacks signaled
+    u32_t wakeups;      // loop passes that found at least one timer due
+} zjs_timer_stats_t;
+
 /**
  * Service the timer module.
  *
- * @return          Shortest time until next expiring timer
+ * @return          Shortest time until next expiring timer in milliseconds, or
+ *                    ZJS_TICKS_FOREVER if there are no timers
  */
 s32_t zjs_timers_process_events();
+
+/**
+ * Run the process.nextTick queue until it is empty
+ *
+ * @return          true if any ticks ran
+ */
+bool zjs_timers_run_ticks();
+
+/**
+ * Run the setImmediate calls queued before this pass, running the
+ * process.nextTick queue after each one
+ *
+ * @return          true if more immediates were queued for the next pass
+ */
+bool zjs_timers_run_immediates();
+
+/**
+ * Get a copy of the timer counters
+ *
+ * Expirations beyond the number of wakeups shared a wakeup with another
+ * timer, so the difference is the wakeups saved by timer slack and by
+ * timers falling due together.
+ *
+ * @param stats     Receives the counters
+ */
+void zjs_get_timer_stats(zjs_timer_stats_t *stats);
+
 void zjs_timers_init();
 // Stops and frees all timers
 void zjs_timers_cleanup();
@@ -23,6 +23,7 @@
 #include "zjs_util.h"
 
 static jerry_value_t zjs_uart_prototype;
+static zjs_event_id read_event = ZJS_EVENT_NONE;
 
 typedef struct {
     const char *name;
@@ -108,7 +109,7 @@ static void uart_c_callback(void *h, const void *args)
         if (buffer) {
             memcpy(buffer->buffer, args, handle->size);
         }
-        zjs_emit_event(handle->uart_obj, "read", &buf, 1);
+        zjs_emit_event_id(handle->uart_obj, read_event, &buf, 1);
 
         handle->size = 0;
     }
@@ -135,6 +136,19 @@ static void uart_irq_handler(struct device *dev)
     }
 }
 
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static void uart_backpressure(void *h, bool pause)
+{
+    // stop draining the FIFO while the callback queue is backed up; the
+    //   hardware flow control or FIFO holds the data until we resume
+    struct device *dev = (struct device *)h;
+    if (pause) {
+        uart_irq_rx_disable(dev);
+    } else {
+        uart_irq_rx_enable(dev);
+    }
+}
+
 static int write_data(struct device *dev, const char *buf, int len)
 {
     uart_irq_tx_enable(dev);
@@ -300,12 +314,19 @@ static ZJS_DECL_FUNC(uart_init)
     zjs_make_emitter(handle->uart_obj, zjs_uart_prototype, NULL, NULL);
 
     read_id = zjs_add_c_callback(handle, uart_c_callback);
+    zjs_set_callback_priority(read_id, ZJS_CALLBACK_PRIORITY_HIGH);
+    // init may be called again, so don't register twice
+    zjs_remove_backpressure(uart_backpressure, uart_dev);
+    zjs_add_backpressure(uart_backpressure, uart_dev);
 
     return handle->uart_obj;
 }
 
 static void zjs_uart_cleanup(void *native)
 {
+    if (uart_dev) {
+        zjs_remove_backpressure(uart_backpressure, uart_dev);
+    }
     jerry_release_value(zjs_uart_prototype);
 }
 
@@ -315,6 +336,8 @@ static const jerry_object_native_info_t uart_module_type_info = {
 
 static jerry_value_t zjs_uart_init()
 {
+    read_event = zjs_event_intern("read");
+
     zjs_native_func_t array[] = {
         { uart_write, "write" },
         { uart_set_read_range, "setReadRange" },
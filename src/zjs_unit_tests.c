@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // C includes
 #include <stdio.h>
@@ -7,7 +7,12 @@
 
 // ZJS includes
 #include "zjs_board.h"
+#include "zjs_buffer.h"
+#include "zjs_bundle.h"
 #include "zjs_callbacks.h"
+#include "zjs_event.h"
+#include "zjs_modules.h"
+#include "zjs_queue.h"
 #include "zjs_util.h"
 
 static int passed = 0;
@@ -67,6 +72,12 @@ static void c_callback4(void *handle, const void *args)
     cb4_called = 1;
 }
 
+static u32_t stale_calls = 0;
+static void c_callback_stale(void *handle, const void *args)
+{
+    stale_calls++;
+}
+
 static void test_c_callbacks()
 {
     zjs_init_callbacks();
@@ -107,9 +118,27 @@ static void test_c_callbacks()
     }
     zjs_service_callbacks();
     zjs_callback_id less = zjs_add_c_callback(NULL, c_callback4);
-    zjs_assert(less < next, "callback IDs are recycled");
+    // IDs carry a generation above the slot index in the low 16 bits
+    zjs_assert((less & 0xffff) < (next & 0xffff), "callback IDs are recycled");
     zjs_remove_callback(next);
     zjs_remove_callback(less);
+    zjs_service_callbacks();
+
+    // test stale IDs are rejected once their slot is reused
+    zjs_callback_id stale = zjs_add_c_callback(NULL, c_callback_stale);
+    zjs_remove_callback(stale);
+    zjs_service_callbacks();
+    zjs_callback_id reused = zjs_add_c_callback(NULL, c_callback_stale);
+    zjs_signal_callback(stale, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert((reused & 0xffff) == (stale & 0xffff) && reused != stale &&
+               stale_calls == 0, "stale callback IDs are rejected");
+    zjs_remove_callback(stale);
+    zjs_service_callbacks();
+    zjs_signal_callback(reused, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert(stale_calls == 1, "stale callback IDs can't remove new ones");
+    zjs_remove_callback(reused);
 
     // test zjs_call_callback
     zjs_callback_id id4 = zjs_add_c_callback(NULL, c_callback4);
@@ -118,6 +147,681 @@ static void test_c_callbacks()
     zjs_remove_callback(id4);
 }
 
+static u32_t spill_next = 0;
+static u8_t spill_in_order = 1;
+static void c_callback_spill(void *handle, const void *args)
+{
+    if (*(u32_t *)args != spill_next++) {
+        spill_in_order = 0;
+    }
+}
+
+static int bp_paused = 0;
+static int bp_resumed = 0;
+static void backpressure(void *handle, bool pause)
+{
+    if (pause) {
+        bp_paused++;
+    } else {
+        bp_resumed++;
+    }
+}
+
+static void test_callback_overflow()
+{
+    zjs_callback_stats_t before, after;
+    zjs_get_callback_stats(&before);
+    zjs_add_backpressure(backpressure, NULL);
+
+    // signal far more than the queue holds without servicing in between
+    zjs_callback_id id = zjs_add_c_callback(NULL, c_callback_spill);
+    for (u32_t i = 0; i < 200; i++) {
+        zjs_signal_callback(id, &i, sizeof(i));
+    }
+    zjs_get_callback_stats(&after);
+    zjs_assert(after.spilled > before.spilled, "overflow: signals spilled");
+    zjs_assert(after.dropped == before.dropped, "overflow: nothing dropped");
+    zjs_assert(bp_paused == 1 && bp_resumed == 0,
+               "overflow: producers paused at high water");
+
+    while (zjs_service_callbacks()) {
+    }
+    zjs_assert(spill_next == 200 && spill_in_order,
+               "overflow: all signals delivered in order");
+    zjs_assert(bp_resumed == 1, "overflow: producers resumed after drain");
+
+    zjs_remove_backpressure(backpressure, NULL);
+    zjs_remove_callback(id);
+    zjs_service_callbacks();
+}
+
+static zjs_callback_id coalesce_id = -1;
+static u32_t coalesce_calls = 0;
+static u32_t coalesce_value = 0;
+static u32_t coalesce_dropped = 0;
+static void c_callback_coalesce(void *handle, const void *args)
+{
+    coalesce_calls++;
+    coalesce_value = *(u32_t *)args;
+    coalesce_dropped = zjs_get_coalesced_count(coalesce_id);
+}
+
+static void test_callback_coalesce()
+{
+    coalesce_id = zjs_add_c_callback(NULL, c_callback_coalesce);
+    zjs_assert(zjs_coalesce_callback(coalesce_id, sizeof(u32_t)),
+               "coalesce: enable on C callback");
+    for (u32_t i = 1; i <= 5; i++) {
+        zjs_signal_callback(coalesce_id, &i, sizeof(i));
+    }
+    // an oversized signal is dropped without pausing producers
+    int paused = bp_paused;
+    zjs_add_backpressure(backpressure, NULL);
+    u32_t big[2] = { 0, 0 };
+    zjs_signal_callback(coalesce_id, big, sizeof(big));
+    zjs_remove_backpressure(backpressure, NULL);
+    zjs_assert(bp_paused == paused, "coalesce: oversized args don't pause");
+    zjs_service_callbacks();
+    zjs_assert(coalesce_calls == 1 && coalesce_value == 5,
+               "coalesce: only newest args delivered");
+    zjs_assert(coalesce_dropped == 4, "coalesce: replaced signals counted");
+
+    u32_t next = 6;
+    zjs_signal_callback(coalesce_id, &next, sizeof(next));
+    zjs_service_callbacks();
+    zjs_assert(coalesce_calls == 2 && coalesce_value == 6 &&
+               coalesce_dropped == 0,
+               "coalesce: next signal starts a new delivery");
+    zjs_remove_callback(coalesce_id);
+    zjs_service_callbacks();
+}
+
+static char prio_order[8];
+static u8_t prio_count = 0;
+static void c_callback_prio(void *handle, const void *args)
+{
+    if (prio_count < sizeof(prio_order) - 1) {
+        prio_order[prio_count++] = *(const char *)handle;
+    }
+}
+
+static void test_callback_priority()
+{
+    zjs_callback_id low = zjs_add_c_callback("l", c_callback_prio);
+    zjs_callback_id high = zjs_add_c_callback("h", c_callback_prio);
+    zjs_assert(zjs_set_callback_priority(high, ZJS_CALLBACK_PRIORITY_HIGH),
+               "priority: set on C callback");
+
+    zjs_signal_callback(low, NULL, 0);
+    zjs_signal_callback(low, NULL, 0);
+    zjs_signal_callback(high, NULL, 0);
+    zjs_signal_callback(high, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert(!strcmp(prio_order, "hhll") && !zjs_callbacks_pending(),
+               "priority: high served before earlier low");
+
+    // with no budget left, each pass serves one high and one low callback
+    memset(prio_order, 0, sizeof(prio_order));
+    prio_count = 0;
+    zjs_set_callback_budget(0);
+    zjs_signal_callback(low, NULL, 0);
+    zjs_signal_callback(low, NULL, 0);
+    zjs_signal_callback(high, NULL, 0);
+    zjs_signal_callback(high, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert(!strcmp(prio_order, "hl") && zjs_callbacks_pending(),
+               "priority: budget bounds one pass");
+    zjs_service_callbacks();
+    zjs_assert(!strcmp(prio_order, "hlhl") && !zjs_callbacks_pending(),
+               "priority: low callbacks not starved");
+    zjs_set_callback_budget(ZJS_CALLBACK_BUDGET_US);
+
+    zjs_remove_callback(low);
+    zjs_remove_callback(high);
+    zjs_service_callbacks();
+}
+
+static u32_t order_next = 0;
+static u32_t order_calls = 0;
+static u8_t order_kept = 1;
+static void c_callback_order(void *handle, const void *args)
+{
+    // signals may be dropped, but never delivered out of order
+    u32_t value = *(const u32_t *)args;
+    if (value < order_next) {
+        order_kept = 0;
+    }
+    order_next = value + 1;
+    order_calls++;
+}
+
+static void test_callback_priority_order()
+{
+    zjs_callback_stats_t before, after;
+    zjs_callback_id id = zjs_add_c_callback(NULL, c_callback_order);
+    zjs_callback_id filler = zjs_add_c_callback(NULL, c_callback4);
+    zjs_set_callback_priority(id, ZJS_CALLBACK_PRIORITY_HIGH);
+    zjs_set_callback_priority(filler, ZJS_CALLBACK_PRIORITY_HIGH);
+    zjs_set_callback_budget(0);
+
+    // overflow the high queue with one callback, serving a little at a time
+    zjs_get_callback_stats(&before);
+    for (u32_t i = 0; i < 100; i++) {
+        zjs_signal_callback(id, &i, sizeof(i));
+        if (i % 10 == 0) {
+            zjs_service_callbacks();
+        }
+    }
+    while (zjs_service_callbacks()) {
+    }
+    zjs_get_callback_stats(&after);
+    zjs_assert(order_kept && order_calls + after.dropped - before.dropped ==
+               100, "priority: overflowed high queue keeps signal order");
+
+    // with the high queue full of other signals, it moves to the low queue,
+    //   and stays there while it has signals waiting
+    order_next = 0;
+    order_calls = 0;
+    for (u32_t i = 0; i < 100; i++) {
+        zjs_signal_callback(filler, NULL, 0);
+    }
+    for (u32_t i = 0; i < 3; i++) {
+        zjs_signal_callback(id, &i, sizeof(i));
+    }
+    zjs_service_callbacks();
+    u32_t last = 3;
+    zjs_signal_callback(id, &last, sizeof(last));
+    zjs_set_callback_budget(ZJS_CALLBACK_BUDGET_US);
+    while (zjs_service_callbacks()) {
+    }
+    zjs_assert(order_kept && order_calls == 4,
+               "priority: fallback to low queue keeps signal order");
+
+    zjs_remove_callback(id);
+    zjs_remove_callback(filler);
+    zjs_service_callbacks();
+}
+
+#ifdef ZJS_LOOP_STATS
+static void c_callback_latency(void *handle, const void *args)
+{
+}
+
+static void test_callback_latency()
+{
+    zjs_callback_id id = zjs_add_c_callback(NULL, c_callback_latency);
+    u32_t value = 0;
+    for (int i = 0; i < 3; i++) {
+        zjs_signal_callback(id, &value, sizeof(value));
+    }
+    zjs_service_callbacks();
+
+    zjs_callback_latency_t entry;
+    bool module_found = false, callback_found = false;
+    for (u32_t i = 0; zjs_get_callback_latency(i, &entry); i++) {
+        if (entry.id < 0 && strstr(entry.module, "zjs_unit_tests.c")) {
+            module_found = entry.count >= 3;
+        } else if (entry.id == id) {
+            callback_found = entry.count == 3 &&
+                             zjs_latency_percentile(entry.wait_hist, 100) >=
+                             entry.wait_max_us;
+        }
+    }
+    zjs_assert(module_found, "latency: module total recorded");
+    zjs_assert(callback_found, "latency: per-callback histogram recorded");
+
+    zjs_remove_callback(id);
+    zjs_service_callbacks();
+    callback_found = false;
+    for (u32_t i = 0; zjs_get_callback_latency(i, &entry); i++) {
+        if (entry.id == id) {
+            callback_found = true;
+        }
+    }
+    zjs_assert(!callback_found, "latency: freed callback no longer tracked");
+}
+#endif
+
+#define BENCH_LIVE_CALLBACKS  10000
+#define BENCH_CYCLES          100000
+static int bench_callback_ids()
+{
+    // microbenchmark: add/remove throughput with many live callbacks
+    zjs_callback_id *live = malloc(sizeof(zjs_callback_id) *
+                                   BENCH_LIVE_CALLBACKS);
+    int failed = 0;
+    for (int i = 0; i < BENCH_LIVE_CALLBACKS; i++) {
+        live[i] = zjs_add_c_callback(NULL, c_callback4);
+        failed |= live[i] < 0;
+    }
+
+    u32_t start = zjs_port_timer_get_uptime();
+    for (int i = 0; i < BENCH_CYCLES; i++) {
+        zjs_callback_id id = zjs_add_c_callback(NULL, c_callback4);
+        failed |= id < 0;
+        zjs_remove_callback(id);
+        if (i % 64 == 0) {
+            zjs_service_callbacks();
+        }
+    }
+    u32_t elapsed = zjs_port_timer_get_uptime() - start;
+    ZJS_PRINT("[bench] %d callback add/remove pairs with %d live: %u ms%s\n",
+              BENCH_CYCLES, BENCH_LIVE_CALLBACKS, elapsed,
+              failed ? " (some adds failed)" : "");
+
+    for (int i = 0; i < BENCH_LIVE_CALLBACKS; i++) {
+        zjs_remove_callback(live[i]);
+    }
+    while (zjs_service_callbacks()) {
+    }
+    free(live);
+    return failed;
+}
+
+static void test_queue()
+{
+    u32_t buf[16];
+    zjs_queue_t queue;
+    zjs_queue_init(&queue, buf, 16);
+
+    u32_t type;
+    u8_t value;
+    u16_t size32;
+    zjs_assert(!zjs_queue_peek(&queue, &type, &value, &size32),
+               "queue: empty queue has no records");
+
+    u32_t args[4] = { 0x12345678, 0x9abcdef0, 0, 0 };
+    zjs_assert(zjs_queue_put(&queue, 7, 3, args, 8) == 0,
+               "queue: put record");
+    zjs_assert(zjs_queue_put(&queue, 1, 0, args, 28) == -EMSGSIZE,
+               "queue: reject record over half the queue");
+
+    // reserved records block the ones after them until committed
+    u32_t *slot = zjs_queue_reserve(&queue, 8, 0, 1);
+    zjs_queue_put(&queue, 9, 0, NULL, 0);
+    u32_t *data = zjs_queue_peek(&queue, &type, &value, &size32);
+    zjs_assert(data && type == 7 && value == 3 && size32 == 2 &&
+               data[0] == args[0] && data[1] == args[1],
+               "queue: peek returns record in place");
+    zjs_assert(!zjs_queue_peek(&queue, &type, &value, &size32),
+               "queue: uncommitted record stops the consumer");
+    *slot = 42;
+    zjs_queue_commit(&queue, slot);
+    data = zjs_queue_peek(&queue, &type, &value, &size32);
+    zjs_assert(data && type == 8 && data[0] == 42,
+               "queue: committed record becomes visible");
+    data = zjs_queue_peek(&queue, &type, &value, &size32);
+    zjs_assert(data && type == 9 && size32 == 0, "queue: FIFO order kept");
+    zjs_queue_release(&queue);
+    zjs_assert(zjs_queue_used(&queue) == 0, "queue: release frees batch");
+
+    // 9 words are used so far, so a 6-word record has to wrap
+    zjs_queue_put(&queue, 10, 0, args, 8);
+    zjs_assert(zjs_queue_put(&queue, 11, 0, args, 16) == 0,
+               "queue: put record across the end");
+    zjs_queue_peek(&queue, &type, &value, &size32);
+    data = zjs_queue_peek(&queue, &type, &value, &size32);
+    zjs_assert(data == &buf[2] && type == 11 && size32 == 4,
+               "queue: padding skips to the start");
+    zjs_assert(zjs_queue_put(&queue, 12, 0, args, 16) == -ENOSPC,
+               "queue: full until released");
+    zjs_queue_release(&queue);
+    zjs_assert(zjs_queue_put(&queue, 12, 0, args, 16) == 0,
+               "queue: room after release");
+}
+
+static s32_t test_routine(void *handle)
+{
+    int *calls = (int *)handle;
+    (*calls)++;
+    if (*calls == 1) {
+        return 20;
+    }
+    if (*calls == 2) {
+        return ZJS_TICKS_FOREVER;
+    }
+    zjs_unregister_service_routine(test_routine);
+    return ZJS_TICKS_NONE;
+}
+
+static void test_service_routines()
+{
+    int calls = 0;
+    zjs_routine_t *routine = zjs_register_service_routine(&calls,
+                                                          test_routine);
+    zjs_assert(routine != NULL, "routines: register");
+
+    // a new routine is due at once, then asks to run again in 20ms
+    u32_t start = zjs_port_timer_get_uptime();
+    s32_t wait = zjs_service_routines();
+    zjs_assert(calls == 1 && wait >= 0 && wait <= 20,
+               "routines: deadline gives the main loop wait");
+    wait = zjs_service_routines();
+    zjs_assert(calls == 1 || zjs_port_timer_get_uptime() - start >= 20,
+               "routines: not run before the deadline");
+
+    while (zjs_port_timer_get_uptime() - start < 21) {
+    }
+    wait = zjs_service_routines();
+    zjs_assert(calls == 2 && wait == ZJS_TICKS_FOREVER,
+               "routines: runs at the deadline and parks");
+    wait = zjs_service_routines();
+    zjs_assert(calls == 2 && wait == ZJS_TICKS_FOREVER,
+               "routines: parked routine not run");
+
+    // waking is what other threads and ISRs do; the routine then
+    //   unregisters itself while being called
+    zjs_wake_service_routine(routine);
+    wait = zjs_service_routines();
+    zjs_assert(calls == 3 && wait == ZJS_TICKS_FOREVER,
+               "routines: woken routine runs and unregisters itself");
+
+    // a late wake from another thread must not run it again
+    zjs_wake_service_routine(routine);
+    wait = zjs_service_routines();
+    zjs_assert(calls == 3 && wait == ZJS_TICKS_FOREVER,
+               "routines: unregistered routine not run");
+
+    // the struct is kept for the next registration
+    int more_calls = 2;  // so the routine unregisters itself on this call
+    zjs_assert(zjs_register_service_routine(&more_calls, test_routine) ==
+               routine, "routines: unregistered routine reused");
+    zjs_service_routines();
+    zjs_assert(calls == 3 && more_calls == 3,
+               "routines: reused routine calls the new handle");
+}
+
+#ifdef BUILD_MODULE_BUFFER
+static void test_buffer_store()
+{
+    zjs_buffer_store_t *store = zjs_buffer_store_alloc(8);
+    u8_t *rptr = store->data;
+    u8_t *wptr = store->data;
+
+    memcpy(wptr, "abcdef", 6);
+    wptr += 6;
+    rptr += 4;
+    zjs_assert(zjs_buffer_store_reserve(&store, &rptr, &wptr, 2) &&
+               wptr == store->data + 6, "buffer store: room at the end");
+
+    zjs_buffer_store_t *first = store;
+    zjs_assert(zjs_buffer_store_reserve(&store, &rptr, &wptr, 4) &&
+               store == first && rptr == store->data &&
+               wptr == store->data + 2 && !memcmp(rptr, "ef", 2),
+               "buffer store: unshared store is reused");
+
+    // a view from JS keeps the old bytes alive and untouched
+    zjs_buffer_store_acquire(store);
+    rptr = wptr;
+    zjs_assert(zjs_buffer_store_reserve(&store, &rptr, &wptr, 8) &&
+               store != first && store->size == 8 && rptr == store->data &&
+               first->refcount == 1 && !memcmp(first->data, "ef", 2),
+               "buffer store: shared store is replaced");
+    zjs_buffer_store_release(first);
+
+    zjs_assert(zjs_buffer_store_reserve(&store, &rptr, &wptr, 20) &&
+               store->size == 20, "buffer store: grows for large writes");
+    zjs_buffer_store_release(store);
+}
+
+static void test_buffer_pool()
+{
+    zjs_buffer_pool_stats_t before, after;
+    zjs_get_buffer_pool_stats(1, &before);
+
+    // just fill a 64-byte block along with the store header
+    u32_t size = 64 - sizeof(zjs_buffer_store_t);
+    zjs_buffer_store_t *store = zjs_buffer_store_alloc(size);
+    zjs_get_buffer_pool_stats(1, &after);
+    zjs_assert(after.block_size == 64 && after.in_use == before.in_use + 1 &&
+               after.allocs == before.allocs + 1,
+               "buffer pool: small store comes from its size class");
+
+    zjs_buffer_store_release(store);
+    zjs_buffer_store_t *again = zjs_buffer_store_alloc(size - 8);
+    zjs_assert(again == store, "buffer pool: freed block is reused");
+    zjs_buffer_store_release(again);
+    zjs_get_buffer_pool_stats(1, &after);
+    zjs_assert(after.in_use == before.in_use && after.peak >= 1,
+               "buffer pool: release returns block to the class");
+
+    u32_t large = ZJS_BUFFER_POOL_MIN_BLOCK << ZJS_BUFFER_POOL_CLASSES;
+    store = zjs_buffer_store_alloc(large);
+    zjs_assert(store && store->size == large,
+               "buffer pool: large store comes from the heap");
+    zjs_buffer_store_release(store);
+    zjs_assert(!zjs_get_buffer_pool_stats(ZJS_BUFFER_POOL_CLASSES, &after),
+               "buffer pool: no stats past the last class");
+}
+#endif
+
+#ifdef BUILD_MODULE_EVENTS
+static void test_event_atoms()
+{
+    zjs_assert(zjs_event_lookup("unit-test-a") == ZJS_EVENT_NONE,
+               "event atoms: lookup does not intern");
+
+    zjs_event_id a = zjs_event_intern("unit-test-a");
+    zjs_event_id b = zjs_event_intern("unit-test-b");
+    zjs_assert(a != ZJS_EVENT_NONE && b != ZJS_EVENT_NONE && a != b,
+               "event atoms: names get distinct atoms");
+    zjs_assert(zjs_event_intern("unit-test-a") == a &&
+               zjs_event_lookup("unit-test-b") == b,
+               "event atoms: same name gives same atom");
+    zjs_assert(strequal(zjs_event_name(a), "unit-test-a"),
+               "event atoms: atom gives back its name");
+    zjs_assert(zjs_event_name(ZJS_EVENT_NONE) == NULL,
+               "event atoms: no name for invalid atom");
+
+    // force the index to grow a few times
+    char name[16];
+    bool found = true;
+    for (int i = 0; i < 100; i++) {
+        sprintf(name, "unit-test-%d", i);
+        zjs_event_intern(name);
+    }
+    for (int i = 0; i < 100; i++) {
+        sprintf(name, "unit-test-%d", i);
+        zjs_event_id id = zjs_event_lookup(name);
+        if (id == ZJS_EVENT_NONE || !strequal(zjs_event_name(id), name)) {
+            found = false;
+        }
+    }
+    zjs_assert(found && zjs_event_lookup("unit-test-a") == a,
+               "event atoms: atoms survive index growth");
+}
+
+#define TEST_MAX_ARGS 8
+
+static u32_t listener_calls = 0;
+static u32_t listener_argc = 0;
+static double listener_args[TEST_MAX_ARGS];
+
+static ZJS_DECL_FUNC(test_listener)
+{
+    listener_calls++;
+    listener_argc = argc;
+    for (u32_t i = 0; i < argc && i < TEST_MAX_ARGS; i++) {
+        listener_args[i] = jerry_get_number_value(argv[i]);
+    }
+    return ZJS_UNDEFINED;
+}
+
+static bool listener_got(u32_t calls, u32_t argc, double first)
+{
+    // effects: checks the last call had argc args numbered up from first
+    if (listener_calls != calls || listener_argc != argc) {
+        return false;
+    }
+    for (u32_t i = 0; i < argc; i++) {
+        if (listener_args[i] != first + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static u32_t pre_calls = 0;
+
+// a zjs_pre_emit callback
+static bool test_min_args(void *unused, jerry_value_t argv[], u32_t *argc,
+                          const char *buffer, u32_t length)
+{
+    pre_calls++;
+    for (u32_t i = 0; i < ZJS_EVENT_MIN_ARGS; i++) {
+        argv[i] = jerry_create_number(10 + i);
+    }
+    *argc = ZJS_EVENT_MIN_ARGS;
+    return true;
+}
+
+static zjs_event_token nested_token = ZJS_EVENT_TOKEN_NONE;
+static u32_t outer_calls = 0;
+static bool outer_intact = false;
+
+static ZJS_DECL_FUNC(test_outer_listener)
+{
+    // emit another deferred event while this one's args are in use
+    outer_calls++;
+    zjs_call_callback(nested_token, NULL, 0);
+    return ZJS_UNDEFINED;
+}
+
+// a zjs_post_emit callback
+static void test_check_outer(void *unused, jerry_value_t argv[], u32_t argc)
+{
+    outer_intact = argc == 5;
+    for (u32_t i = 0; i < argc; i++) {
+        if (jerry_get_number_value(argv[i]) != 1 + i) {
+            outer_intact = false;
+        }
+    }
+    zjs_release_args(unused, argv, argc);
+}
+
+static void test_event_args()
+{
+    ZVAL emitter = zjs_create_object();
+    zjs_make_emitter(emitter, ZJS_UNDEFINED, NULL, NULL);
+    ZVAL listener = jerry_create_external_function(test_listener);
+    ZVAL outer = jerry_create_external_function(test_outer_listener);
+    zjs_add_event_listener(emitter, "unit-args", listener);
+    zjs_add_event_listener(emitter, "unit-outer", outer);
+    zjs_add_event_listener(emitter, "unit-nested", listener);
+
+    // more args than ZJS_EVENT_MIN_ARGS get room from the buffer size
+    jerry_value_t args[5];
+    for (int i = 0; i < 5; i++) {
+        args[i] = jerry_create_number(1 + i);
+    }
+    listener_calls = 0;
+    zjs_defer_emit_event(emitter, "unit-args", args, sizeof(args),
+                         zjs_copy_args, zjs_release_args);
+    zjs_service_callbacks();
+    zjs_assert(listener_got(1, 5, 1), "event args: five args passed through");
+
+    // a pre function may always fill ZJS_EVENT_MIN_ARGS
+    zjs_defer_emit_event(emitter, "unit-args", NULL, 0, test_min_args,
+                         zjs_release_args);
+    zjs_service_callbacks();
+    zjs_assert(listener_got(2, ZJS_EVENT_MIN_ARGS, 10),
+               "event args: room for the minimum args");
+
+    // the nested emit must not reuse the outer event's args
+    nested_token = zjs_register_deferred_event(emitter, "unit-nested",
+                                               test_min_args,
+                                               zjs_release_args);
+    for (int i = 0; i < 5; i++) {
+        args[i] = jerry_create_number(1 + i);
+    }
+    zjs_defer_emit_event(emitter, "unit-outer", args, sizeof(args),
+                         zjs_copy_args, test_check_outer);
+    zjs_service_callbacks();
+    zjs_assert(outer_calls == 1 &&
+               listener_got(3, ZJS_EVENT_MIN_ARGS, 10),
+               "event args: nested emit gets its own args");
+    zjs_assert(outer_intact, "event args: outer args kept across nested emit");
+    zjs_unregister_deferred_event(emitter, nested_token);
+}
+
+static void test_event_tokens()
+{
+    jerry_value_t emitter = zjs_create_object();
+    zjs_make_emitter(emitter, ZJS_UNDEFINED, NULL, NULL);
+    ZVAL listener = jerry_create_external_function(test_listener);
+    zjs_add_event_listener(emitter, "unit-token", listener);
+    zjs_add_event_listener(emitter, "unit-bare", listener);
+    zjs_event_token token = zjs_register_deferred_event(emitter, "unit-token",
+                                                        zjs_copy_args,
+                                                        zjs_release_args);
+    zjs_event_token bare = zjs_register_deferred_event(emitter, "unit-bare",
+                                                       test_min_args,
+                                                       zjs_release_args);
+    zjs_assert(token != ZJS_EVENT_TOKEN_NONE && bare != ZJS_EVENT_TOKEN_NONE,
+               "event tokens: register");
+
+    jerry_value_t args[2] = { jerry_create_number(7), jerry_create_number(8) };
+    listener_calls = 0;
+    zjs_defer_emit_token(token, args, sizeof(args));
+    zjs_service_callbacks();
+    zjs_assert(listener_got(1, 2, 7), "event tokens: payload becomes args");
+
+    pre_calls = 0;
+    zjs_defer_emit_token(bare, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert(pre_calls == 1 && listener_got(2, ZJS_EVENT_MIN_ARGS, 10),
+               "event tokens: no payload still runs pre");
+
+    // emits queued before the token goes away are dropped
+    zjs_defer_emit_token(token, NULL, 0);
+    zjs_unregister_deferred_event(emitter, token);
+    zjs_service_callbacks();
+    zjs_assert(listener_calls == 2,
+               "event tokens: emit queued before unregister dropped");
+
+    zjs_defer_emit_token(bare, NULL, 0);
+    jerry_release_value(emitter);
+    jerry_gc();
+    zjs_service_callbacks();
+    zjs_assert(pre_calls == 1 && listener_calls == 2,
+               "event tokens: emit queued before emitter freed dropped");
+}
+#endif
+
+static void test_bundle()
+{
+    struct {
+        zjs_bundle_header_t header;
+        zjs_bundle_entry_t entries[2];
+        uint32_t snapshots[4];
+    } __attribute__((aligned(8))) bundle = {
+        { ZJS_BUNDLE_MAGIC, 2 },
+        {
+            { ZJS_BUNDLE_MAIN, sizeof(zjs_bundle_header_t) +
+                               2 * sizeof(zjs_bundle_entry_t), 8 },
+            { "Module.js", sizeof(zjs_bundle_header_t) +
+                           2 * sizeof(zjs_bundle_entry_t) + 8, 8 }
+        }
+    };
+    const uint32_t *data = (const uint32_t *)&bundle;
+
+    zjs_assert(zjs_bundle_check(data, sizeof(bundle)),
+               "bundle: well-formed bundle accepted");
+    zjs_assert(!zjs_bundle_check(data, sizeof(bundle) - 4),
+               "bundle: snapshot past the end rejected");
+    bundle.entries[1].offset += 4;
+    zjs_assert(!zjs_bundle_check(data, sizeof(bundle)),
+               "bundle: unaligned snapshot rejected");
+    bundle.entries[1].offset -= 4;
+    bundle.header.count = 1000;
+    zjs_assert(!zjs_bundle_check(data, sizeof(bundle)),
+               "bundle: entries past the end rejected");
+    bundle.header.count = 2;
+    bundle.header.magic = 0;
+    zjs_assert(!zjs_bundle_check(data, sizeof(bundle)),
+               "bundle: bad magic rejected");
+}
+
 static void test_hex_to_byte()
 {
     zjs_assert(check_hex_to_byte("00", 0), "hex to byte: 00");
@@ -526,6 +1230,25 @@ void zjs_run_unit_tests()
     test_compress_32();
     test_validate_args();
     test_c_callbacks();
+    test_callback_overflow();
+    test_callback_coalesce();
+    test_callback_priority();
+    test_callback_priority_order();
+#ifdef ZJS_LOOP_STATS
+    test_callback_latency();
+#endif
+    test_queue();
+    test_service_routines();
+#ifdef BUILD_MODULE_BUFFER
+    test_buffer_store();
+    test_buffer_pool();
+#endif
+#ifdef BUILD_MODULE_EVENTS
+    test_event_atoms();
+    test_event_args();
+    test_event_tokens();
+#endif
+    test_bundle();
     test_list_macros();
     test_str_matches();
     test_split_pin_name();
@@ -533,3 +1256,10 @@ void zjs_run_unit_tests()
     printf("TOTAL - %d of %d passed\n", passed, total);
     exit(!(passed == total));
 }
+
+void zjs_run_benchmarks()
+{
+    zjs_init_callbacks();
+    int failed = bench_callback_ids();
+    exit(failed);
+}
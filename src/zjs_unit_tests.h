@@ -1,3 +1,6 @@
-// Copyright (c) 2016, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 void zjs_run_unit_tests();
+
+// run the microbenchmarks, printing their timings, and exit
+void zjs_run_benchmarks();
@@ -433,20 +433,20 @@ int zjs_require_string_if_prop_map(jerry_value_t obj, const char *prop,
 
 void free_handle_nop(void *h);
 
-#ifndef ZJS_LINUX_BUILD
-#ifndef ZJS_ASHELL
+#if defined(ZJS_LINUX_BUILD) || !defined(ZJS_ASHELL)
 /*
  * Unblock the main loop
  */
 void zjs_loop_unblock(void);
 
 /*
- * Block in the main loop for a specified amount of time
+ * Block in the main loop for a specified amount of time (in milliseconds, or
+ * ZJS_TICKS_FOREVER to wait until zjs_loop_unblock() is called)
  */
 void zjs_loop_block(int time);
 
 /*
- * Initialize the main loop blocking semaphore
+ * Initialize the main loop blocking primitives
  */
 void zjs_loop_init(void);
 #else
@@ -454,7 +454,6 @@ void zjs_loop_init(void);
 #define zjs_loop_block(time) do {} while(0)
 #define zjs_loop_init() do {} while(0)
 #endif
-#endif
 
 // Type definition to be used with macros below
 // struct list_item {
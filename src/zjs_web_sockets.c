@@ -79,13 +79,14 @@ typedef struct server_handle {
 typedef struct ws_connection {
     struct net_context *tcp_sock;
     server_handle_t *server_h;
-    u8_t *rbuf;
+    zjs_buffer_store_t *rstore;
     u8_t *wptr;
     u8_t *rptr;
     struct ws_connection *next;
     char *accept_key;
     jerry_value_t server;
     jerry_value_t conn;
+    zjs_event_token message_token;
     zjs_callback_id accept_handler_id;
     ws_state state;
 } ws_connection_t;
@@ -443,9 +444,10 @@ static void consume_data(ws_connection_t *con, u16_t len)
     // effects: mark len bytes of data as read in the connection
     FTRACE("con = %p, len = %d\n", con, (u32_t)len);
     con->rptr += len;
-    if (con->rptr == con->wptr) {
+    if (con->rptr == con->wptr && con->rstore->refcount == 1) {
+        // only rewind if JS isn't holding views of the data
         DBG_PRINT("all data consumed, reseting read buffer\n");
-        con->rptr = con->wptr = con->rbuf;
+        con->rptr = con->wptr = con->rstore->data;
     }
 }
 
@@ -460,9 +462,11 @@ static bool trigger_data(void *h, jerry_value_t argv[], u32_t *argc,
     ws_connection_t *con = (ws_connection_t *)h;
     u16_t len = *(u16_t *)buffer;
     zjs_buffer_t *buf;
-    jerry_value_t buf_obj = zjs_buffer_create(len, &buf);
+    jerry_value_t buf_obj = zjs_buffer_create_view(con->rstore,
+                                                   con->rptr -
+                                                   con->rstore->data,
+                                                   len, &buf);
     if (buf) {
-        memcpy(buf->buffer, con->rptr, len);
         consume_data(con, len);
         argv[0] = buf_obj;
         *argc = 1;
@@ -495,7 +499,7 @@ static void close_connection(void *h, jerry_value_t argv[], u32_t argc)
     ZJS_LIST_REMOVE(ws_connection_t, con->server_h->connections, con);
 
     net_context_put(con->tcp_sock);
-    zjs_free(con->rbuf);
+    zjs_buffer_store_release(con->rstore);
     zjs_free(con->accept_key);
     zjs_remove_callback(con->accept_handler_id);
     if (con->conn) {
@@ -536,6 +540,13 @@ static void process_packet(ws_connection_t *con, u8_t *data, u32_t len)
         return;
     }
 
+    if (!zjs_buffer_store_reserve(&con->rstore, &con->rptr, &con->wptr,
+                                  packet->payload_len)) {
+        emit_error(con->conn, "out of memory");
+        zjs_free(packet->payload);
+        zjs_free(packet);
+        return;
+    }
     memcpy(con->wptr, packet->payload, packet->payload_len);
     con->wptr += packet->payload_len;
 
@@ -548,8 +559,7 @@ static void process_packet(ws_connection_t *con, u8_t *data, u32_t len)
         // continuation frame
     case WS_PACKET_TEXT_DATA:
         // text data
-        zjs_defer_emit_event(con->conn, "message", &plen, sizeof(plen),
-                             trigger_data, zjs_release_args);
+        zjs_defer_emit_token(con->message_token, &plen, sizeof(plen));
         break;
     case WS_PACKET_BINARY_DATA:
         // binary data (TODO: why is this ignored?)
@@ -649,6 +659,9 @@ static jerry_value_t create_ws_connection(ws_connection_t *con)
     zjs_obj_add_function(conn, "pong", ws_pong);
     zjs_obj_add_function(conn, "terminate", ws_terminate);
     zjs_make_emitter(conn, ZJS_UNDEFINED, con, NULL);
+    con->message_token = zjs_register_deferred_event(conn, "message",
+                                                     trigger_data,
+                                                     zjs_release_args);
     if (con->server_h->track) {
         ZVAL clients = zjs_get_property(con->server_h->server, "clients");
         ZVAL new = zjs_push_array(clients, conn);
@@ -854,7 +867,7 @@ static void tcp_received(struct net_context *context,
     receive.con = con;
     receive.pkt = pkt;
 
-    zjs_defer_work(receive_packet, &receive, sizeof(receive));
+    zjs_defer_io_work(receive_packet, &receive, sizeof(receive));
 }
 
 static void post_accept_handler(void *handle, jerry_value_t ret_val)
@@ -927,16 +940,16 @@ static void accept_connection(const void *buffer, u32_t length)
         return;
     }
     memset(con, 0, sizeof(ws_connection_t));
+    con->message_token = ZJS_EVENT_TOKEN_NONE;
     con->tcp_sock = accept->context;
-    con->rbuf = zjs_malloc(DEFAULT_WS_BUFFER_SIZE);
-    if (!con->rbuf) {
+    con->rstore = zjs_buffer_store_alloc(DEFAULT_WS_BUFFER_SIZE);
+    if (!con->rstore) {
         ERR_PRINT("could not allocate read buffer\n");
         emit_error(server_h->server, "out of memory");
         zjs_free(con);
         return;
     }
-    memset(con->rbuf, 0, sizeof(DEFAULT_WS_BUFFER_SIZE));
-    con->rptr = con->wptr = con->rbuf;
+    con->rptr = con->wptr = con->rstore->data;
     con->server = server_h->server;
     con->server_h = server_h;
     if (jerry_value_is_function(server_h->accept_handler)) {
@@ -985,7 +998,7 @@ static void tcp_accepted(struct net_context *context,
         return;
     }
 
-    zjs_defer_work(accept_connection, &accept, sizeof(accept));
+    zjs_defer_io_work(accept_connection, &accept, sizeof(accept));
 }
 
 static ZJS_DECL_FUNC(ws_server)
@@ -1,8 +1,9 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef ZJS_ZEPHYR_PORT_H_
 #define ZJS_ZEPHYR_PORT_H_
 
+#include <atomic.h>
 #include <zephyr.h>
 
 #define zjs_port_timer_cb               k_timer_expiry_t
@@ -11,14 +12,19 @@
 #define zjs_port_timer_start(t, i, r)   k_timer_start(t, r, r)
 #define zjs_port_timer_stop             k_timer_stop
 #define zjs_port_timer_get_uptime       k_uptime_get_32
+#define zjs_port_get_cycles             k_cycle_get_32
+#define zjs_port_cycles_to_us(c)        \
+    ((u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(c) / 1000))
 #define ZJS_TICKS_NONE                  TICKS_NONE
 #define ZJS_TICKS_FOREVER               K_FOREVER
 #define zjs_sleep                       k_sleep
 
-#define zjs_port_ring_buf               ring_buf
-#define zjs_port_ring_buf_init          sys_ring_buf_init
-#define zjs_port_ring_buf_get           sys_ring_buf_get
-#define zjs_port_ring_buf_put           sys_ring_buf_put
+#define zjs_port_atomic_t               atomic_t
+#define zjs_port_atomic_get             atomic_get
+#define zjs_port_atomic_set             atomic_set
+#define zjs_port_atomic_cas             atomic_cas
+#define zjs_port_atomic_inc             atomic_inc
+#define zjs_port_atomic_dec             atomic_dec
 
 #define zjs_port_sem_init               k_sem_init
 #define zjs_port_sem_take               k_sem_take
@@ -1,4 +1,4 @@
-// Copyright (c) 2016, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // Buffer read/write tests
 
@@ -101,4 +101,36 @@ assert(buf.readUInt8(4) == 0xce && buf.readUInt8(5) == 0xfa &&
        buf.readUInt8(6) == 0xad && buf.readUInt8(7) == 0xbe,
        "writeUInt32LE: write long, offset 4");
 
+// test bulk array reads and writes
+var abuf = new Buffer([0x01, 0x80, 0xff, 0xff, 0x00, 0x00, 0x80, 0x3f]);
+var values = abuf.readInt16Array(0, 2);
+assert(values.length == 2 && values[0] == -32767 && values[1] == -1,
+       "readInt16Array: little endian by default");
+values = abuf.readUInt16Array(0, 2, 'BE');
+assert(values[0] == 0x0180 && values[1] == 0xffff,
+       "readUInt16Array: big endian");
+assert(abuf.readFloat32Array(4, 1)[0] == 1, "readFloat32Array: read 1.0");
+assert(abuf.readInt8Array(1, 2)[1] == -1, "readInt8Array: signed bytes");
+var target = [0, 0, 0];
+assert(abuf.readUInt8Array(5, 3, undefined, target) === target &&
+       target[2] == 0x3f, "readUInt8Array: fill existing array");
+assert.throws(function () {
+    abuf.readUInt32Array(4, 2);
+}, "readUInt32Array: out of bounds");
+assert.throws(function () {
+    abuf.readUInt32Array(0, 1, 'middle');
+}, "readUInt32Array: invalid endian");
+
+assert(abuf.writeInt16Array([-2, 0x1234], 0, 'BE') == 4 &&
+       abuf.readUInt32BE(0) == 0xfffe1234, "writeInt16Array: big endian");
+assert(abuf.writeFloat64Array([-2.5], 0) == 8 &&
+       abuf.readFloat64Array(0, 1)[0] == -2.5,
+       "writeFloat64Array: round trip");
+assert(abuf.writeUInt32Array([0xdeadbeef, 7], 0) == 8 &&
+       abuf.readUInt8(0) == 0xef && abuf.readUInt32Array(4, 1)[0] == 7,
+       "writeUInt32Array: little endian by default");
+assert.throws(function () {
+    abuf.writeUInt16Array([1, 2, 3], 4);
+}, "writeUInt16Array: out of bounds");
+
 assert.result();
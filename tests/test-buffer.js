@@ -194,6 +194,13 @@ assert(buff.toString('hex') === '01020301020300000203', 'copy to end');
 srcbuf.copy(buff, 6, 1, 2);
 assert(buff.toString('hex') === '01020301020302000203', 'copy part');
 
+// slices share their parent's memory, so copies between them can overlap
+var cbuf = new Buffer([1, 2, 3, 4, 5, 6]);
+cbuf.copy(cbuf.slice(1), 0, 0, 5);
+assert(cbuf.toString('hex') === '010102030405', 'copy into overlapping slice');
+cbuf.slice(1).copy(cbuf);
+assert(cbuf.toString('hex') === '010203040505', 'copy from overlapping slice');
+
 assert.throws(function () {
     srcbuf.copy(buff, 2, 4);
 }, "Error thrown copying beyond source buffer");
@@ -238,6 +245,73 @@ assert(ubuf.toString('utf8') === '¡ƵĴƧ ƦǾ©ĶƧ!', 'toString with utf8 enc
 assert(ubuf.toString('ascii') == "B!F5D4F' F&G>B)D6F'!",
        'toString with ascii encoding');
 
+// Test encodings
+var ebuf = new Buffer([0x66, 0x6f, 0x6f, 0x62, 0x61, 0xe9]);
+assert(ebuf.toString('base64') === 'Zm9vYmHp', 'toString with base64');
+assert(ebuf.toString('base64', 0, 4) === 'Zm9vYg==', 'base64 with padding');
+assert(ebuf.toString('hex', 1, 3) === '6f6f', 'toString hex with range');
+assert(ebuf.toString('latin1', 4) === 'a\u00e9', 'toString with latin1');
+assert(ebuf.toString('utf8', 2, 1) === '', 'toString with end before start');
+assert(new Buffer('Zm9vYmHp', 'base64').toString('hex') === '666f6f6261e9',
+       'Buffer from base64 string');
+assert(new Buffer('00ff7Fzz', 'hex').toString('hex') === '00ff7f',
+       'Buffer from hex string stops at invalid digits');
+assert(new Buffer('a\u00e9', 'latin1').toString('hex') === '61e9',
+       'Buffer from latin1 string');
+ebuf.fill(0);
+assert(ebuf.write('c0ffee', 1, 3, 'hex') === 3 &&
+       ebuf.toString('hex') === '00c0ffee0000', 'write with hex encoding');
+assert(ebuf.write('hi') === 2 && ebuf.toString('utf8', 0, 2) === 'hi',
+       'write shorter string than buffer');
+ebuf.fill('AQI=', 0, 6, 'base64');
+assert(ebuf.toString('hex') === '010201020102', 'fill with base64 encoding');
+
+// Test slice function, which shares memory with the original
+var sbuf = new Buffer('abcdefgh');
+var slice = sbuf.slice(2, 5);
+assert(slice.length === 3 && slice.toString() === 'cde', 'slice range');
+slice.writeUInt8(0x43, 0);
+assert(sbuf.toString() === 'abCdefgh', 'slice shares memory with parent');
+assert(sbuf.slice(-3).toString() === 'fgh', 'slice with negative start');
+assert(sbuf.slice(1, -6).toString() === 'b', 'slice with negative end');
+assert(sbuf.slice(6, 100).toString() === 'gh', 'slice end clamped');
+assert(sbuf.slice(5, 2).length === 0, 'slice with end before start');
+assert(sbuf.slice().length === 8, 'slice whole buffer');
+var sub = sbuf.subarray(4).slice(1, 3);
+assert(sub.toString() === 'fg', 'slice of a subarray');
+sbuf = null;
+assert(sub.readUInt8(0) === 0x66, 'slice outlives parent');
+
+// Test sharing memory with ArrayBuffer and TypedArrays, where supported
+if (typeof ArrayBuffer !== 'undefined') {
+    var abuf = new Buffer([1, 2, 3, 4, 5, 6]).slice(2);
+    assert(abuf.byteOffset === 2 && abuf.buffer.byteLength === 6,
+           'buffer property covers the whole backing store');
+    assert(abuf.buffer === abuf.buffer, 'buffer property is cached');
+    var u8 = new Uint8Array(abuf.buffer, abuf.byteOffset, abuf.length);
+    u8[0] = 0x33;
+    assert(abuf.readUInt8(0) === 0x33, 'TypedArray writes show in Buffer');
+
+    var ab = new ArrayBuffer(8);
+    var shared = new Buffer(ab, 4);
+    shared.writeUInt8(0x44, 1);
+    assert(shared.length === 4 && new Uint8Array(ab)[5] === 0x44,
+           'Buffer writes show in ArrayBuffer');
+    assert.throws(function () {
+        new Buffer(ab, 4, 5);
+    }, 'Error thrown for ArrayBuffer range out of bounds');
+
+    var i16 = new Int16Array(2);
+    new Buffer([0xff, 0xff, 0x02, 0x01]).readInt16Array(0, 2, 'LE', i16);
+    assert(i16[0] === -1 && i16[1] === 0x0102, 'readInt16Array into Int16Array');
+
+    var obuf = new Buffer([1, 2, 3, 4, 5, 6]);
+    var view = new Uint8Array(obuf.buffer, obuf.byteOffset + 1, 4);
+    obuf.readUInt8Array(0, 4, undefined, view);
+    assert(obuf.toString('hex') === '010102030406',
+           'readUInt8Array into an overlapping view of itself');
+}
+
 /*
  * We don't support Math functions currently or noAssert option to buffer writes
  *
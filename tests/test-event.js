@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // Testing EVENT APIs
 
@@ -89,6 +89,18 @@ assert(listenersName.length === 10,
 var eventsName;
 eventsName = eventEmitter.eventNames();
 assert(eventsName.length === 3, "event: get all events name");
+assert(eventsName[0] === "event_noArg" &&
+       eventsName[1] === "event_moreArg" &&
+       eventsName[2] === "event_listener",
+       "event: get events name in the order added");
+
+var orderEmitter = new event();
+var orderNames = ["zeta", "alpha", "mid", "beta", "omega", "gamma"];
+for (var i = 0; i < orderNames.length; i++) {
+    orderEmitter.on(orderNames[i], function() {});
+}
+assert(orderEmitter.eventNames().join() === orderNames.join(),
+       "event: events name keep their order as more are added");
 
 // test remove all listeners
 var oldAllListenersNum, newAllListenersNum;
@@ -0,0 +1,39 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Global modules are only built when the script first reads them, so look at
+//   them before anything else uses them
+var global = this;
+var bufferBefore = Object.getOwnPropertyDescriptor(global, "Buffer");
+var consoleBefore = Object.getOwnPropertyDescriptor(global, "console");
+
+// replacing a global before reading it skips building the module
+console = { log: print };
+var consoleAfter = Object.getOwnPropertyDescriptor(global, "console");
+
+var assert = require("Assert.js");
+
+assert(typeof bufferBefore.get === "function" && bufferBefore.configurable,
+       "globals: Buffer deferred until first use");
+assert(typeof consoleBefore.get === "function",
+       "globals: console deferred until first use");
+assert(consoleAfter.value.log === print && console.log === print,
+       "globals: assigned value replaces deferred global");
+
+assert("Buffer" in global, "globals: deferred global visible to 'in'");
+var buf = new Buffer(4);
+assert(buf.length === 4 && buf instanceof Buffer,
+       "globals: Buffer built on first use");
+
+var bufferAfter = Object.getOwnPropertyDescriptor(global, "Buffer");
+assert(bufferAfter.value === Buffer && bufferAfter.get === undefined,
+       "globals: first use replaces accessor with the module");
+
+// the accessor functions stay reachable, but only work once
+assert(bufferBefore.get.call(global) === Buffer && typeof Buffer === "function",
+       "globals: saved getter leaves the built module in place");
+bufferBefore.set.call(global, 5);
+assert(Buffer === bufferAfter.value, "globals: saved setter does nothing");
+assert(consoleBefore.get.call(global).log === print,
+       "globals: saved getter doesn't replace an assigned value");
+
+assert.result();
@@ -3,6 +3,19 @@
 var performance = require("performance");
 var assert = require("Assert.js");
 
+var stats = performance.callbackStats();
+assert(typeof stats.dropped === "number" && stats.dropped === 0,
+       "callbackStats: no callbacks dropped");
+assert(stats.queueSize > 0 && stats.highWater >= stats.pending,
+       "callbackStats: queue size and high-water mark reported");
+
+var elu = performance.eventLoopUtilization();
+assert(typeof elu.idle === "number" && elu.utilization >= 0 &&
+       elu.utilization <= 1, "eventLoopUtilization: utilization reported");
+
+// gives callbackLatency() a finished timer callback to report
+setTimeout(function() {}, 10);
+
 var before = performance.now();
 
 setTimeout(function() {
@@ -10,5 +23,28 @@ setTimeout(function() {
     var diff = after - before;
     // Allow for some jitter, especially on Linux
     assert(diff >= 979 && diff <= 1021, "performance.now() result over known delay");
+
+    var delta = performance.eventLoopUtilization(elu);
+    assert(delta.idle > 900 && delta.active >= 0,
+           "eventLoopUtilization: idle while waiting for timer");
+
+    var delay = performance.monitorEventLoopDelay(true);
+    assert(delay.count > 0 && delay.min <= delay.p50 &&
+           delay.p50 <= delay.p99 && delay.p99 <= delay.max,
+           "monitorEventLoopDelay: lag percentiles ordered");
+    assert(performance.monitorEventLoopDelay().count === 0,
+           "monitorEventLoopDelay: reset clears counters");
+
+    var stats = performance.timerStats();
+    assert(stats.expirations >= stats.wakeups && stats.wakeups > 0 &&
+           stats.wakeupsSaved === stats.expirations - stats.wakeups,
+           "timerStats: wakeups counted");
+
+    var timers = performance.callbackLatency().filter(function(entry) {
+        return entry.module === "zjs_timers.c" && entry.id === undefined;
+    });
+    assert(timers.length === 1 && timers[0].count > 0 &&
+           timers[0].waitMax >= timers[0].waitMean,
+           "callbackLatency: timer callbacks measured");
     assert.result();
 }, 1000);
@@ -0,0 +1,32 @@
+// Copyright (c) 2018, Intel Corporation.
+
+var assert = require("Assert.js");
+var performance = require("performance");
+
+var before = performance.requireStats();
+assert(require("Assert.js") === assert, "require: JS module is shared");
+assert(require("performance") === performance,
+       "require: native module is shared");
+
+var after = performance.requireStats();
+assert(after.hits === before.hits + 2 && after.misses === before.misses,
+       "requireStats: cached calls counted as hits");
+
+assert(require.cache["Assert.js"] === assert &&
+       require.cache["performance"] === performance,
+       "require.cache: modules kept by name");
+
+delete require.cache["performance"];
+var reloaded = require("performance");
+assert(reloaded !== performance && require.cache["performance"] === reloaded,
+       "require.cache: deleted module loaded again");
+assert(performance.requireStats().misses === before.misses + 1,
+       "requireStats: reload counted as a miss");
+
+assert.throws(function() {
+    require("no-such-module");
+}, "require: missing module throws");
+assert(!("no-such-module" in require.cache),
+       "require.cache: failed module not cached");
+
+assert.result();
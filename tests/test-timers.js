@@ -1,8 +1,9 @@
-// Copyright (c) 2016, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 // Timers tests
 
 var assert = require("Assert.js");
+var performance = require("performance");
 
 // test setInterval and clearInterval
 var countFlag = 10;
@@ -80,6 +81,77 @@ assert.throws(function () {
     clearTimeout(NotExistedTimeoutID);
 }, "clearTimeout: timeoutID does not exist");
 
+// test timeouts fire in deadline order, and in creation order for ties
+var fired = [];
+setTimeout(function () { fired.push(3); }, 300);
+setTimeout(function () { fired.push(1); }, 100);
+setTimeout(function () { fired.push(2); }, 200);
+setTimeout(function () { fired.push(4); }, 300);
+var cancelled = setTimeout(function () { fired.push(0); }, 150);
+clearTimeout(cancelled);
+
+setTimeout(function () {
+    assert(fired.join() === "1,2,3,4", "setTimeout: fire in deadline order");
+}, 500);
+
+// test timer slack: both fire in one wakeup once the first may be put off;
+//   start after the timers above are done so none of them shares the wakeup
+var slackFired = [];
+var slackStats = [];
+setTimeout(function () {
+    slackStats.push(performance.timerStats());
+    var slackTimer = setTimeout(function () {
+        slackFired.push(1);
+        slackStats.push(performance.timerStats());
+    }, 100);
+    assert(slackTimer.setSlack(100) === slackTimer, "setSlack: returns timer");
+    setTimeout(function () {
+        slackFired.push(2);
+        slackStats.push(performance.timerStats());
+    }, 150);
+
+    assert.throws(function () {
+        slackTimer.setSlack(-1);
+    }, "setSlack: negative slack");
+
+    setTimeout(function () {
+        assert(slackFired.join() === "1,2",
+               "setSlack: timers still fire in order");
+        assert(slackStats[1].wakeups === slackStats[2].wakeups,
+               "setSlack: timers fire in one wakeup");
+        assert(slackStats[2].wakeupsSaved >= slackStats[0].wakeupsSaved + 1,
+               "setSlack: wakeup saved");
+    }, 300);
+}, 1100);
+
+// test setImmediate, clearImmediate and process.nextTick ordering
+var order = [];
+setImmediate(function (arg) {
+    order.push(arg);
+    setImmediate(function () {
+        order.push("next pass");
+    });
+    process.nextTick(function () {
+        order.push("tick in immediate");
+    });
+}, "immediate");
+var cancelledImmediate = setImmediate(function () {
+    order.push("cancelled");
+});
+clearImmediate(cancelledImmediate);
+process.nextTick(function (arg1, arg2) {
+    order.push(arg1 + arg2);
+    process.nextTick(function () {
+        order.push("nested tick");
+    });
+}, "ti", "ck");
+
+setTimeout(function () {
+    assert(order.join() ===
+           "tick,nested tick,immediate,tick in immediate,next pass",
+           "setImmediate: run after ticks, in order, and not when cleared");
+}, 500);
+
 setTimeout(function () {
     assert.result();
 }, 2000);
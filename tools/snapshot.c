@@ -1,71 +1,289 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
+// snapshot - compile an application and the JS modules it requires into one
+//   snapshot bundle, see src/zjs_bundle.h
+//
+//   snapshot [-m modules_dir] [-o bundle_file] [-c header_file] app.js
+//
+//   A module is bundled when a require() call names it with a string literal
+//   and a file by that name exists in modules_dir (default "modules"); the
+//   modules it requires are bundled in turn. The bundle is written in binary
+//   to bundle_file and as a C array to header_file, or as a C array to stdout
+//   if neither is given. A size report goes to stderr.
+
+#include <ctype.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include "zjs_bundle.h"
 #include "zjs_script.h"
 
 // JerryScript includes
 #include "jerryscript.h"
 
-#define SNAPSHOT_BUFFER_SIZE 51200
+// a snapshot that doesn't fit in this much has gone wrong in some other way
+#define MAX_SNAPSHOT_SIZE (16 * 1024 * 1024)
+
+typedef struct bundle_item {
+    char name[ZJS_BUNDLE_NAME_LEN];
+    char *source;
+    uint32_t source_len;
+    uint32_t *snapshot;
+    uint32_t size;
+    bool is_static;
+} bundle_item_t;
 
-static uint32_t snapshot_buf[SNAPSHOT_BUFFER_SIZE];
+static bundle_item_t *items = NULL;
+static int item_count = 0;
+static const char *modules_dir = "modules";
 
-static void generate_snapshot(uint32_t *buf, int buf_size)
+static bool add_item(const char *name, char *path)
 {
-    for (int i = 0; i < buf_size / sizeof(uint32_t); i++)
-    {
-        if (i > 0) {
-            printf(",");
+    for (int i = 0; i < item_count; i++) {
+        if (!strcmp(items[i].name, name)) {
+            return true;
         }
-        printf("0x%08lx", (unsigned long)buf[i]);
     }
+
+    bundle_item_t *grown = realloc(items, (item_count + 1) * sizeof(*items));
+    if (!grown) {
+        fprintf(stderr, "out of memory\n");
+        return false;
+    }
+    items = grown;
+
+    bundle_item_t *item = &items[item_count];
+    memset(item, 0, sizeof(*item));
+    strcpy(item->name, name);
+    if (zjs_read_script(path, &item->source, &item->source_len)) {
+        fprintf(stderr, "could not read script file %s\n", path);
+        return false;
+    }
+    item_count++;
+    return true;
 }
 
-int main(int argc, char *argv[])
+static bool add_required_modules(const char *source)
 {
-    char *script = NULL;
-    uint32_t len;
+    // matches what scripts/analyze looks for: require, optional spaces, and a
+    //   quoted name in parentheses
+    for (const char *p = source; (p = strstr(p, "require")); ) {
+        const char *start = p;
+        p += strlen("require");
+        if (start > source && (isalnum(start[-1]) || start[-1] == '_' ||
+                               start[-1] == '$' || start[-1] == '.')) {
+            continue;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p != '(' || (p[1] != '"' && p[1] != '\'')) {
+            continue;
+        }
+        char quote = p[1];
+        const char *name = p + 2;
+        const char *end = strchr(name, quote);
+        if (!end || end[1] != ')' || end - name >= ZJS_BUNDLE_NAME_LEN) {
+            continue;
+        }
+        p = end;
 
-    jerry_init(JERRY_INIT_EMPTY);
+        char module[ZJS_BUNDLE_NAME_LEN];
+        memcpy(module, name, end - name);
+        module[end - name] = '\0';
+        if (strchr(module, '/')) {
+            continue;
+        }
 
-    if (argc <= 1) {
-        fprintf(stderr, "missing script file\n");
-        return 1;
+        char path[strlen(modules_dir) + ZJS_BUNDLE_NAME_LEN + 2];
+        sprintf(path, "%s/%s", modules_dir, module);
+        if (access(path, R_OK)) {
+            // a native module, or one that will be found at runtime
+            continue;
+        }
+        if (!add_item(module, path)) {
+            return false;
+        }
     }
+    return true;
+}
 
-    if (zjs_read_script(argv[1], &script, &len)) {
-        fprintf(stderr, "could not read script file %s\n", argv[1]);
-        return 1;
+static bool compile(bundle_item_t *item)
+{
+    // parse first, so a syntax error isn't mistaken for a small buffer below
+    jerry_value_t parsed = jerry_parse(NULL, 0, (jerry_char_t *)item->source,
+                                       item->source_len, JERRY_PARSE_NO_OPTS);
+    bool ok = !jerry_value_is_error(parsed);
+    jerry_release_value(parsed);
+    if (!ok) {
+        fprintf(stderr, "JerryScript: failed to parse %s\n",
+                item->name[0] ? item->name : "application");
+        return false;
+    }
+
+    uint32_t buf_size = (4 * item->source_len + 1024) & ~3;
+    for (; buf_size <= MAX_SNAPSHOT_SIZE; buf_size *= 2) {
+        uint32_t *buf = malloc(buf_size);
+        if (!buf) {
+            break;
+        }
+        item->size = zjs_generate_snapshot(item->source, item->source_len,
+                                           buf, buf_size, &item->is_static);
+        if (item->size) {
+            item->snapshot = buf;
+            return true;
+        }
+        free(buf);
+    }
+    fprintf(stderr, "JerryScript: failed to create snapshot of %s\n",
+            item->name[0] ? item->name : "application");
+    return false;
+}
+
+static uint32_t align8(uint32_t offset)
+{
+    return (offset + 7) & ~7;
+}
+
+static uint32_t *build_bundle(uint32_t *length)
+{
+    uint32_t offset = sizeof(zjs_bundle_header_t) +
+                      item_count * sizeof(zjs_bundle_entry_t);
+    for (int i = 0; i < item_count; i++) {
+        offset = align8(offset) + items[i].size;
+    }
+
+    uint32_t *bundle = calloc(1, offset);
+    if (!bundle) {
+        fprintf(stderr, "out of memory\n");
+        return NULL;
+    }
+    *length = offset;
+
+    zjs_bundle_header_t *header = (zjs_bundle_header_t *)bundle;
+    header->magic = ZJS_BUNDLE_MAGIC;
+    header->count = item_count;
+    offset = sizeof(zjs_bundle_header_t) +
+             item_count * sizeof(zjs_bundle_entry_t);
+    for (int i = 0; i < item_count; i++) {
+        zjs_bundle_entry_t *entry = &header->entries[i];
+        offset = align8(offset);
+        strcpy(entry->name, items[i].name);
+        entry->offset = offset;
+        entry->size = items[i].size;
+        memcpy((uint8_t *)bundle + offset, items[i].snapshot, items[i].size);
+        offset += items[i].size;
     }
+    return bundle;
+}
 
-    jerry_value_t snapshot_result;
-    snapshot_result = jerry_generate_snapshot(NULL,
-                                              0,
-                                              (const jerry_char_t *)script,
-                                              len,
-                                              0,
-                                              snapshot_buf,
-                                              sizeof(snapshot_buf));
+static void print_report(uint32_t length)
+{
+    fprintf(stderr, "Snapshot bundle: %u bytes\n", length);
+    fprintf(stderr, "  %-32s %8s %8s  %s\n", "module", "source", "snapshot",
+            "literals");
+    for (int i = 0; i < item_count; i++) {
+        fprintf(stderr, "  %-32s %8u %8u  %s\n",
+                items[i].name[0] ? items[i].name : "(application)",
+                items[i].source_len, items[i].size,
+                items[i].is_static ? "static" : "heap");
+    }
+}
+
+static bool write_c_array(FILE *f, const uint32_t *bundle, uint32_t length)
+{
+    for (uint32_t i = 0; i < length / sizeof(uint32_t); i++) {
+        fprintf(f, "%s0x%08lx", i == 0 ? "" : (i % 8 ? "," : ",\n"),
+                (unsigned long)bundle[i]);
+    }
+    fprintf(f, "\n");
+    return !ferror(f);
+}
+
+static bool write_file(const char *name, const uint32_t *bundle,
+                       uint32_t length, bool c_array)
+{
+    FILE *f = fopen(name, "w");
+    if (!f) {
+        fprintf(stderr, "could not create %s\n", name);
+        return false;
+    }
+    bool ok = c_array ? write_c_array(f, bundle, length)
+                      : fwrite(bundle, length, 1, f) == 1;
+    if (fclose(f) || !ok) {
+        fprintf(stderr, "could not write %s\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *bundle_file = NULL;
+    const char *header_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:o:c:")) != -1) {
+        switch (opt) {
+        case 'm':
+            modules_dir = optarg;
+            break;
+        case 'o':
+            bundle_file = optarg;
+            break;
+        case 'c':
+            header_file = optarg;
+            break;
+        default:
+            return 1;
+        }
+    }
 
-    if (jerry_value_is_error(snapshot_result)) {
-        fprintf(stderr, "JerryScript: failed to parse JS and create snapshot\n");
+    if (optind >= argc) {
+        fprintf(stderr, "missing script file\n");
         return 1;
     }
 
-    size_t size = (size_t)jerry_get_number_value(snapshot_result);
-    jerry_release_value(snapshot_result);
+    jerry_init(JERRY_INIT_EMPTY);
 
-    if (script != NULL)
-        free(script);
+    // the application comes first, then modules in the order found
+    if (!add_item(ZJS_BUNDLE_MAIN, argv[optind])) {
+        return 1;
+    }
+    for (int i = 0; i < item_count; i++) {
+        if (!add_required_modules(items[i].source)) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < item_count; i++) {
+        if (!compile(&items[i])) {
+            return 1;
+        }
+    }
 
-    if (size == 0) {
-        fprintf(stderr, "JerryScript: snapshot size is zero\n");
+    uint32_t length;
+    uint32_t *bundle = build_bundle(&length);
+    if (!bundle) {
         return 1;
     }
+    print_report(length);
 
-    // store the snapshot as byte array in header
-    generate_snapshot(snapshot_buf, size);
+    if (bundle_file && !write_file(bundle_file, bundle, length, false)) {
+        return 1;
+    }
+    if (header_file && !write_file(header_file, bundle, length, true)) {
+        return 1;
+    }
+    if (!bundle_file && !header_file && !write_c_array(stdout, bundle, length)) {
+        return 1;
+    }
 
+    for (int i = 0; i < item_count; i++) {
+        free(items[i].source);
+        free(items[i].snapshot);
+    }
+    free(items);
+    free(bundle);
+    jerry_cleanup();
     return 0;
 }